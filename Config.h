@@ -27,6 +27,22 @@ static const char APN[] = "iot.1nce.net";
 static const char MASTER_URL[]  = READ_BASE LUOGO "&c=master";
 static const char SLAVE1_URL[]  = READ_BASE LUOGO "&c=slave1";
 static const char SLAVE2_URL[]  = READ_BASE LUOGO "&c=slave2";
+// Weekly program download per role (see Schedule.h for the body format)
+#define SCHEDULE_BASE "http://guasertemp.online/irrigazione/leggiprogrammi.php?luogo="
+static const char MASTER_SCHEDULE_URL[] = SCHEDULE_BASE LUOGO "&c=master";
+static const char SLAVE1_SCHEDULE_URL[] = SCHEDULE_BASE LUOGO "&c=slave1";
+static const char SLAVE2_SCHEDULE_URL[] = SCHEDULE_BASE LUOGO "&c=slave2";
+
+// Compact command format: polls add "&f=b" and the server may answer with
+// "B:" + a 16-char base64url record instead of ID=..;Z=..;T=..;M=..;S=..
+// (22 chars for version 2, which adds L= and the schedule version V=).
+// Text replies are always accepted. A corrupt compact reply is followed by
+// an immediate text-only poll; further failures in a row keep polls on text
+// for 2, 4, ... up to COMPACT_MAX_TEXT_POLLS polls, a good compact reply
+// resets that.
+static const bool COMPACT_PAYLOAD = true;
+static const uint8_t COMPACT_MAX_TEXT_POLLS = 32;
+#define COMPACT_PAYLOAD_PREFIX "B:"
 
 // Status update endpoint (legacy base; used for posting updates only)
 // SIM900 prefers http://
@@ -59,14 +75,17 @@ static const uint8_t PUMP_ZONE_SLAVE1 = 5;
 #if ROLE == ROLE_MASTER
 #define ROLE_NAME "MASTER"
 #define ROLE_URL MASTER_URL
+#define ROLE_SCHEDULE_URL MASTER_SCHEDULE_URL
 static const int8_t* const ACTIVE_ZONE_TO_PIN = zoneToPinMaster;
 #elif ROLE == ROLE_SLAVE1
 #define ROLE_NAME "SLAVE1"
 #define ROLE_URL SLAVE1_URL
+#define ROLE_SCHEDULE_URL SLAVE1_SCHEDULE_URL
 static const int8_t* const ACTIVE_ZONE_TO_PIN = zoneToPinSlave1;
 #elif ROLE == ROLE_SLAVE2
 #define ROLE_NAME "SLAVE2"
 #define ROLE_URL SLAVE2_URL
+#define ROLE_SCHEDULE_URL SLAVE2_SCHEDULE_URL
 static const int8_t* const ACTIVE_ZONE_TO_PIN = zoneToPinSlave2;
 #else
 #define ROLE_NAME "UNKNOWN"
@@ -76,7 +95,96 @@ static const int8_t* const ACTIVE_ZONE_TO_PIN = zoneToPinSlave2;
 // Timings
 static const unsigned long SERIAL_BAUD = 9600;
 static const unsigned long SIM900_BAUD = 9600;
-static const unsigned long POLL_INTERVAL_MS = 60000;
+static const unsigned long POLL_INTERVAL_MS = 60000;          // while a run is active
+static const unsigned long POLL_FAST_INTERVAL_MS = 15000;     // waiting for a peer transition
+static const unsigned long POLL_IDLE_MAX_INTERVAL_MS = 900000; // idle backoff ceiling (15 min)
+static const unsigned long POLL_FAST_WINDOW_MS = 300000;      // give up fast polling after 5 min
+static const uint32_t POLL_NEAR_END_S = 120;                  // fast poll in the last 2 min of a run
+static const uint16_t POLL_MAX_PER_HOUR = 150;                // hard ceiling on command polls
+static const unsigned long POLL_MAX_DELAY_MS = 20000;         // a due poll waits at most this for other jobs
+static const uint8_t MODEM_JOB_QUEUE_SIZE = 8;                // pending HTTP/AT jobs for the modem
+static const uint8_t POLL_MAX_RECORDS = 4;                     // command records handled per poll body
+
+// Push wake-up: an SMS or a call from one of these numbers triggers an
+// immediate poll. Comma-separated, exactly as the modem reports them in
+// +CLIP/+CMT/+CMGR (e.g. "+393331234567,+393339876543"). Empty disables it.
+#ifndef PUSH_WAKE_NUMBERS
+#define PUSH_WAKE_NUMBERS ""
+#endif
+static const bool PUSH_WAKE_ENABLED = sizeof(PUSH_WAKE_NUMBERS) > 1;
+static const unsigned long POLL_IDLE_MAX_INTERVAL_PUSH_MS = 3600000UL; // idle ceiling with push
+
+// Offline schedule: weekly programs kept in EEPROM and run from the local clock
+static const uint8_t SCHEDULE_MAX_PROGRAMS = 16;
+static const unsigned long SCHEDULE_REFRESH_MS = 21600000UL;   // re-download every 6 h
+static const unsigned long SCHEDULE_RETRY_MS = 300000UL;       // no schedule yet, or the poll says V= changed
+static const unsigned long CLOCK_SYNC_INTERVAL_MS = 3600000UL; // AT+CCLK? every hour
+static const unsigned long CLOCK_RETRY_MS = 60000UL;           // until the RTC reads valid
+static const uint16_t SCHEDULE_MAX_CATCHUP_MIN = 5;  // start programs missed by at most this
+static const uint8_t CLOCK_MIN_VALID_YEAR = 24;      // yy below this means RTC never set
+// Local runs report irrigation id LOCAL_RUN_ID_BASE + program id, a range the
+// server never assigns, so they cannot be confused with a dashboard run
+static const long LOCAL_RUN_ID_BASE = 2000000000L;
+
+// Optional direct link between the boards (RS-485 transceiver on Serial1,
+// pins 18/19). Status transitions reach the other boards in milliseconds;
+// the server path stays in charge and covers any frame that gets lost.
+static const bool PEER_LINK_ENABLED = false;
+static const unsigned long PEER_LINK_BAUD = 19200;
+static const int8_t PEER_LINK_DE_PIN = 4;              // transceiver DE/RE, -1 if auto-direction
+static const unsigned long PEER_LINK_RETRY_MS = 60;    // resend an unacknowledged status
+static const uint8_t PEER_LINK_RETRIES = 5;
+static const unsigned long PEER_LINK_SLOT_MS = 10;     // ack slot per role, avoids collisions
+
+// Optional hall-effect flow meter on the main line, on the board that drives
+// the pump. Pin 2 is external interrupt INT4 on the Mega. Pulses are counted
+// per run; the delivered volume is reported as v= (liters) with every status
+// update and an L= field in a command ends the run once that volume is reached.
+#ifndef FLOW_METER_ENABLED
+#define FLOW_METER_ENABLED false
+#endif
+static const uint8_t FLOW_METER_PIN = 2;
+static const uint32_t FLOW_PULSES_PER_LITER_X100 = 45000; // K-factor x100 (YF-S201: 450 P/L)
+static const unsigned long FLOW_START_GRACE_MS = 30000;   // pipes filling, no checks yet
+static const unsigned long FLOW_CHECK_WINDOW_MS = 10000;
+static const uint16_t FLOW_MIN_LPM = 2;    // below this in a window: no-flow fault
+static const uint16_t FLOW_MAX_LPM = 60;   // above this in a window: over-flow (burst) fault
+
+// Low-power idle: the AVR idle-sleeps until the next deadline (poll, timer,
+// schedule, peer link) or serial input. The SIM900 uses slow-clock mode
+// (AT+CSCLK=1) between transactions when its DTR pin is wired here and is
+// woken by pulling DTR low MODEM_WAKE_MS before the first command.
+#ifndef LOW_POWER_IDLE
+#define LOW_POWER_IDLE true
+#endif
+#ifndef MODEM_DTR_PIN
+#define MODEM_DTR_PIN -1                              // -1: no DTR, modem stays awake
+#endif
+static const unsigned long MODEM_WAKE_MS = 60;        // SIM900 needs 50 ms after DTR low
+static const unsigned long LOW_POWER_MIN_IDLE_MS = 2;
+static const unsigned long LOW_POWER_MAX_IDLE_MS = 60000;
+// Supply currents for the energy estimate (uA)
+static const uint32_t MCU_ACTIVE_UA = 70000;          // Mega 2560 board, running
+static const uint32_t MCU_IDLE_UA = 45000;            // Mega 2560 board, idle sleep
+static const uint32_t MODEM_ACTIVE_UA = 80000;        // SIM900 GPRS transaction (average)
+static const uint32_t MODEM_SLEEP_UA = 1500;          // SIM900 slow clock, registered
+
+// Watchdog: the AVR watchdog resets the board ~8 s after loop() stops running,
+// or once a supervised subsystem (poller, irrigation timer) has not checked
+// in for WATCHDOG_STALL_MS. The reset cause and the subsystem it happened in
+// are reported with the next status update.
+static const bool WATCHDOG_ENABLED = true;
+static const unsigned long WATCHDOG_STALL_MS = 90000;         // longer than LOW_POWER_MAX_IDLE_MS
+static const unsigned long WATCHDOG_POLL_STALL_MS = 300000UL; // due poll not started on an idle modem (5 min)
+
+// Modem traffic capture: records every byte exchanged with the SIM900 into a
+// RAM buffer (2 bytes per byte traced) from boot, or from the last 'c', until
+// it is full. Send 'd' on Serial to dump it. The default (3 KB) holds the
+// modem setup, the first poll and the status update of a run it starts
+// (about 1200 records on the host emulator). Set to 0 to compile it out.
+#ifndef MODEM_TRACE_RECORDS
+#define MODEM_TRACE_RECORDS 1536
+#endif
 
 // Error handling
 // Error LED pin (default to onboard LED). Changeable here.
@@ -1,8 +1,9 @@
 #include "EepromStore.h"
 
-uint16_t EepromStore::computeChecksum(const PersistedIrrigation& data) {
-  const uint8_t* p = reinterpret_cast<const uint8_t*>(&data);
-  size_t len = sizeof(PersistedIrrigation) - sizeof(uint16_t);
+static_assert(sizeof(PersistedIrrigation) <= 64, "irrigation record overlaps the schedule block");
+static_assert(64 + sizeof(StoredSchedule) <= 256, "schedule block overlaps the reset record");
+
+uint16_t EepromStore::computeChecksum(const uint8_t* p, size_t len) {
   uint16_t sum = 0;
   for (size_t i = 0; i < len; i++) {
     sum = (sum << 1) ^ p[i];
@@ -10,6 +11,21 @@ uint16_t EepromStore::computeChecksum(const PersistedIrrigation& data) {
   return sum;
 }
 
+uint16_t EepromStore::computeChecksum(const PersistedIrrigation& data) {
+  return computeChecksum(reinterpret_cast<const uint8_t*>(&data),
+                         sizeof(PersistedIrrigation) - sizeof(uint16_t));
+}
+
+uint16_t EepromStore::computeChecksum(const StoredSchedule& data) {
+  return computeChecksum(reinterpret_cast<const uint8_t*>(&data),
+                         sizeof(StoredSchedule) - sizeof(uint16_t));
+}
+
+uint16_t EepromStore::computeChecksum(const ResetRecord& data) {
+  return computeChecksum(reinterpret_cast<const uint8_t*>(&data),
+                         sizeof(ResetRecord) - sizeof(uint16_t));
+}
+
 bool EepromStore::load(PersistedIrrigation& out) {
   EEPROM.get(kAddress, out);
   if (out.magic != kMagic || out.version != kVersion) return false;
@@ -36,3 +52,32 @@ void EepromStore::clear() {
 }
 
 
+
+bool EepromStore::loadSchedule(StoredSchedule& out) {
+  EEPROM.get(kScheduleAddress, out);
+  if (out.magic != kScheduleMagic || out.version != kScheduleVersion) return false;
+  if (out.checksum != computeChecksum(out)) return false;
+  return out.count <= SCHEDULE_MAX_PROGRAMS;
+}
+
+void EepromStore::saveSchedule(const StoredSchedule& data) {
+  StoredSchedule temp = data;
+  temp.magic = kScheduleMagic;
+  temp.version = kScheduleVersion;
+  temp.checksum = computeChecksum(temp);
+  EEPROM.put(kScheduleAddress, temp); // put() only rewrites bytes that changed
+}
+
+bool EepromStore::loadResetRecord(ResetRecord& out) {
+  EEPROM.get(kResetAddress, out);
+  if (out.magic != kResetMagic || out.version != kResetVersion) return false;
+  return out.checksum == computeChecksum(out);
+}
+
+void EepromStore::saveResetRecord(const ResetRecord& data) {
+  ResetRecord temp = data;
+  temp.magic = kResetMagic;
+  temp.version = kResetVersion;
+  temp.checksum = computeChecksum(temp);
+  EEPROM.put(kResetAddress, temp);
+}
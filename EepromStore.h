@@ -5,6 +5,8 @@
 #include <EEPROM.h>
 #include "Config.h"
 #include "Irrigation.h"
+#include "Schedule.h"
+#include "Watchdog.h"
 
 struct PersistedIrrigation {
   uint16_t magic;
@@ -12,6 +14,7 @@ struct PersistedIrrigation {
   uint8_t active;            // 1 if an irrigation is active
   IrrigationCommand cmd;     // embedded command snapshot
   uint32_t remainingSeconds;
+  uint32_t deliveredMl;      // flow meter volume so far
   uint8_t role;              // ROLE_MASTER or ROLE_SLAVE
   uint16_t checksum;
 };
@@ -22,13 +25,28 @@ public:
   static void save(const PersistedIrrigation& data);
   static void clear();
 
+  static bool loadSchedule(StoredSchedule& out);
+  static void saveSchedule(const StoredSchedule& data);
+
+  static bool loadResetRecord(ResetRecord& out);
+  static void saveResetRecord(const ResetRecord& data);
+
 private:
+  static uint16_t computeChecksum(const uint8_t* p, size_t len);
   static uint16_t computeChecksum(const PersistedIrrigation& data);
+  static uint16_t computeChecksum(const StoredSchedule& data);
+  static uint16_t computeChecksum(const ResetRecord& data);
   static const int kAddress = 0;
   static const uint16_t kMagic = 0xA51C;
-  static const uint8_t kVersion = 2;
+  static const uint8_t kVersion = 3;
+  // Schedule block sits after the irrigation record, with room for it to grow
+  static const int kScheduleAddress = 64;
+  static const uint16_t kScheduleMagic = 0x5C4E;
+  static const uint8_t kScheduleVersion = 1;
+  // Reset cause and breadcrumb for the watchdog, after the schedule block
+  static const int kResetAddress = 256;
+  static const uint16_t kResetMagic = 0x7E5E;
+  static const uint8_t kResetVersion = 1;
 };
 
 #endif
-
-
@@ -0,0 +1,105 @@
+#include "FlowMeter.h"
+
+// Written only by the ISR; 32-bit reads need interrupts off on AVR
+static volatile uint32_t g_flowPulses = 0;
+
+static void onFlowPulse() {
+  g_flowPulses++;
+}
+
+// Pulses expected in one check window at the given rate
+static uint32_t windowPulsesAt(uint16_t litersPerMinute) {
+  uint32_t perMinute = (uint32_t)litersPerMinute * FLOW_PULSES_PER_LITER_X100 / 100;
+  return perMinute * (FLOW_CHECK_WINDOW_MS / 1000) / 60;
+}
+
+FlowMeter::FlowMeter()
+  : running(false),
+    runFault(FlowOk),
+    runStartMs(0),
+    runStartPulses(0),
+    runBaseMl(0),
+    runEndPulses(0),
+    windowArmed(false),
+    windowStartMs(0),
+    windowStartPulses(0),
+    minWindowPulses(windowPulsesAt(FLOW_MIN_LPM)),
+    maxWindowPulses(windowPulsesAt(FLOW_MAX_LPM)),
+    lastWindowPulses(0) {
+}
+
+void FlowMeter::begin() {
+  pinMode(FLOW_METER_PIN, INPUT_PULLUP); // open-collector sensor output
+  attachInterrupt(digitalPinToInterrupt(FLOW_METER_PIN), onFlowPulse, FALLING);
+}
+
+uint32_t FlowMeter::readPulses() {
+  noInterrupts();
+  uint32_t p = g_flowPulses;
+  interrupts();
+  return p;
+}
+
+// Split into whole liters and remainder so pulses * 100000 never overflows
+uint32_t FlowMeter::pulsesToMl(uint32_t pulses) {
+  uint32_t centi = pulses * 100UL; // good for 42M pulses, far beyond a run
+  uint32_t liters = centi / FLOW_PULSES_PER_LITER_X100;
+  uint32_t rest = centi % FLOW_PULSES_PER_LITER_X100;
+  return liters * 1000UL + rest * 1000UL / FLOW_PULSES_PER_LITER_X100;
+}
+
+void FlowMeter::startRun(uint32_t deliveredMl) {
+  running = true;
+  runFault = FlowOk;
+  runStartMs = millis();
+  runStartPulses = readPulses();
+  runBaseMl = deliveredMl;
+  windowArmed = false;
+  lastWindowPulses = 0;
+}
+
+void FlowMeter::stopRun() {
+  if (!running) return;
+  runEndPulses = readPulses();
+  running = false;
+}
+
+uint32_t FlowMeter::runMilliliters() const {
+  uint32_t end = running ? readPulses() : runEndPulses;
+  return runBaseMl + pulsesToMl(end - runStartPulses);
+}
+
+uint16_t FlowMeter::runLiters() const {
+  uint32_t l = runMilliliters() / 1000UL;
+  return l > 0xFFFF ? 0xFFFF : (uint16_t)l;
+}
+
+void FlowMeter::update(uint32_t now) {
+  if (!running || runFault != FlowOk) return;
+  uint32_t pulses = readPulses();
+  if (!windowArmed) {
+    if (now - runStartMs < FLOW_START_GRACE_MS) return;
+    windowArmed = true;
+    windowStartMs = now;
+    windowStartPulses = pulses;
+    return;
+  }
+  if (now - windowStartMs < FLOW_CHECK_WINDOW_MS) return;
+  // A late update() stretches the window; scale the count back to it
+  uint32_t n = pulses - windowStartPulses;
+  uint32_t span = now - windowStartMs;
+  lastWindowPulses = (uint32_t)((uint64_t)n * FLOW_CHECK_WINDOW_MS / span);
+  if (lastWindowPulses < minWindowPulses) runFault = FlowNone;
+  else if (lastWindowPulses > maxWindowPulses) runFault = FlowExcess;
+  windowStartMs = now;
+  windowStartPulses = pulses;
+}
+
+void FlowMeter::printStats(Print& out) const {
+  out.print("[flow] run="); out.print(runMilliliters());
+  out.print("mL window="); out.print(lastWindowPulses);
+  out.print(" (min="); out.print(minWindowPulses);
+  out.print(" max="); out.print(maxWindowPulses);
+  out.print(") fault="); out.print((uint8_t)runFault);
+  out.print(" total="); out.println(readPulses());
+}
@@ -0,0 +1,48 @@
+#ifndef FLOW_METER_H
+#define FLOW_METER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+enum FlowFault {
+  FlowOk,
+  FlowNone,     // pump on but (almost) nothing flows: dry well, closed valve
+  FlowExcess    // far more than the zones can take: burst pipe
+};
+
+// Hall-effect flow meter on an external interrupt. The ISR only counts
+// pulses; volume and rate are worked out from the count in loop() context
+// with integer math on the K-factor (FLOW_PULSES_PER_LITER_X100).
+class FlowMeter {
+public:
+  FlowMeter();
+
+  void begin();                         // attach the interrupt
+  void startRun(uint32_t deliveredMl);  // deliveredMl > 0 when resuming after a reset
+  void stopRun();
+  void update(uint32_t now);            // fault window check, call while running
+  uint32_t runMilliliters() const;
+  uint16_t runLiters() const;
+  FlowFault fault() const { return runFault; }
+  void printStats(Print& out) const;
+
+  static uint32_t pulsesToMl(uint32_t pulses);
+
+private:
+  static uint32_t readPulses();
+
+  bool running;
+  FlowFault runFault;
+  uint32_t runStartMs;
+  uint32_t runStartPulses;
+  uint32_t runBaseMl;          // volume delivered before a reset
+  uint32_t runEndPulses;       // frozen count after stopRun()
+  bool windowArmed;
+  uint32_t windowStartMs;
+  uint32_t windowStartPulses;
+  uint32_t minWindowPulses;
+  uint32_t maxWindowPulses;
+  uint32_t lastWindowPulses;
+};
+
+#endif
@@ -10,39 +10,49 @@ IrrigationManager::IrrigationManager(Sim900Client& modem)
     currentCmd(),
     remainingSeconds(0),
     lastTickMs(0),
-    lastPersistMs(0) {
+    lastPersistMs(0),
+    lastServerStatus(0xFF),
+    lastServerStatusMs(0),
+    lastServerForRole(false),
+    lastServerCmd(),
+    peer(NULL),
+    lastRelayedStopId(-1),
+    flow(NULL),
+    lastFlowFault(FlowOk) {
 }
 
 void IrrigationManager::begin() {
   //first turn everything off before restoring from eeprom 
   // ensure outputs off
-  for (uint8_t z = 1; z <= ZONES_MAX; z++) zoneOff(z);
-  if (ROLE == ROLE_MASTER) pumpOff();
+  allOutputsOff();
   
   //restore from eeprom
-  if (restore()) {
+  uint32_t deliveredMl = 0;
+  if (restore(deliveredMl)) {
     LOG("Resumed irr. ID="); LOG(currentCmd.id); LOG(" status="); LOG(currentCmd.status);
     LOG(" remaining="); LOG(remainingSeconds); LOGln("s");
     // Re-apply outputs for role
-    if (ROLE == ROLE_MASTER && (currentCmd.status == 3)) {
-      pumpOn();
-      applyZones(currentCmd, true);
-      state = Running;
-    } else if (ROLE == ROLE_SLAVE1 && (currentCmd.status == 1 || currentCmd.status == 2 || currentCmd.status == 3)) {
-      applyZones(currentCmd, true);
-      state = Running;
-    } else if (ROLE == ROLE_SLAVE2 && (currentCmd.status == 2 || currentCmd.status == 3)) {
+    if (currentCmd.status < STATUS_COUNT && (ThisRole::kResumeMask & (1U << currentCmd.status))) {
+      if (ThisRole::kDrivesPump) pumpOn();
       applyZones(currentCmd, true);
       state = Running;
     } else {
       state = Idle;
     }
+    if (state == Running) startFlow(deliveredMl);
   } 
   lastTickMs = millis();
   lastPersistMs = lastTickMs;
 }
 
+uint32_t IrrigationManager::msUntilNextTick(uint32_t now) const {
+  if (state != Running) return 0xFFFFFFFFUL;
+  uint32_t elapsed = now - lastTickMs;
+  return elapsed >= 1000 ? 0 : 1000 - elapsed;
+}
+
 void IrrigationManager::tick() {
+  watchdog.checkIn(SubIrrigation);
   if (state != Running) return;
   //if irrigation is running, 
   //check if 1 second has passed since last tick, if so, decrement remaining seconds
@@ -51,9 +61,21 @@ void IrrigationManager::tick() {
     lastTickMs = now;
     if (remainingSeconds > 0) remainingSeconds--;
   }
+  if (flow) {
+    flow->update(now);
+    if (flow->fault() != FlowOk) {
+      stopOnFlowFault();
+      return;
+    }
+    // Volume target reached: finish exactly like a timed run
+    if (currentCmd.targetLiters > 0 && flow->runLiters() >= currentCmd.targetLiters) {
+      remainingSeconds = 0;
+    }
+  }
   //Update remaining minutes in real time 
   if (state == Running && (remainingSeconds % 60) == 0) {
-    ParserServer::sendStatusUpdate(currentCmd.id, currentCmd.status, (uint8_t) (remainingSeconds/60));
+    ParserServer::sendStatusUpdate(currentCmd.id, currentCmd.status, (uint8_t) (remainingSeconds/60),
+                                   flow ? flow->runLiters() : 0);
   }
   //if 15 seconds have passed since last persist, persist the current state
   if (now - lastPersistMs >= 120000) {
@@ -62,16 +84,8 @@ void IrrigationManager::tick() {
   }
   //if remaining seconds is 0, stop the irrigation
   if (remainingSeconds == 0) {
-    // Time's up -> owner stops
-    if (ROLE == ROLE_MASTER) {
-      // Master-owned timing (pump=2 scenario)
-      stopMasterComplete(currentCmd);   
-    } else if (ROLE == ROLE_SLAVE1) {
-      // Slave1-owned timing when its pump zone is active
-      stopSlaveComplete(currentCmd);
-    } else if (ROLE == ROLE_SLAVE2) {
-      stopSlaveComplete(currentCmd);
-    }
+    // Time's up -> every board closes its own part and reports completion
+    endRun(currentCmd, ThisRole::kCompleteStatus);
   }
 }
 
@@ -96,155 +110,177 @@ void IrrigationManager::applyZones(const IrrigationCommand& cmd, bool on) {
   }
 }
 
+// A status transition: queue it for the server and push it to the peer boards
+void IrrigationManager::reportStatus(uint8_t status, uint8_t remainingMinutes) {
+  uint16_t liters = 0;
+  if (flow) {
+    if (state != Running) flow->stopRun(); // freeze the run's volume
+    liters = flow->runLiters();
+  }
+  ParserServer::sendStatusUpdate(currentCmd.id, status, remainingMinutes, liters, lastFlowFault);
+  lastFlowFault = FlowOk;
+  if (peer) peer->publish(currentCmd.id, status, remainingMinutes);
+}
+
+void IrrigationManager::startFlow(uint32_t deliveredMl) {
+  if (flow) flow->startRun(deliveredMl);
+}
+
+// No water (or far too much) while this board drives the pump: shut it all
+// down and report it as this role's STOP (MASTER S=8, so the slaves follow)
+void IrrigationManager::stopOnFlowFault() {
+  lastFlowFault = flow->fault();
+  LOG("Flow fault "); LOG(lastFlowFault); LOG(" irr. ID="); LOGln(currentCmd.id);
+  endRun(currentCmd, ThisRole::kStopStatus);
+}
+
+// A peer's transition arrives before the server would tell us about it.
+// Run it through the same rules as a polled command; the peer frame has no
+// zone list, so it only applies to the irrigation we already know.
+void IrrigationManager::onPeerStatus(const PeerStatus& ps) {
+  IrrigationCommand cmd;
+  if (lastServerCmd.valid && lastServerCmd.id == ps.id) cmd = lastServerCmd;
+  else if (currentCmd.valid && currentCmd.id == ps.id) cmd = currentCmd;
+  else if (state == Running && currentCmd.id >= LOCAL_RUN_ID_BASE) {
+    cmd.valid = true;             // may be a STOP meant for the local run
+    cmd.id = ps.id;
+  }
+  else return;
+  cmd.status = ps.status;
+  cmd.remainingMinutes = ps.minutes;
+  if (ps.status == 7) lastRelayedStopId = ps.id; // already on the link
+  onServerCommand(cmd);
+}
+
 void IrrigationManager::persist(bool active) {
   PersistedIrrigation s;
   s.active = active ? 1 : 0;
   s.cmd = currentCmd;
   s.remainingSeconds = remainingSeconds;
+  s.deliveredMl = (active && flow) ? flow->runMilliliters() : 0;
   s.role = ROLE;
   EepromStore::save(s);
 }
 
-bool IrrigationManager::restore() {
+bool IrrigationManager::restore(uint32_t& deliveredMl) {
   PersistedIrrigation s;
   if (!EepromStore::load(s)) return false;
   currentCmd = s.cmd;
   currentCmd.valid = true; 
   if (currentCmd.numZones > ZONES_MAX) currentCmd.numZones = ZONES_MAX;
   remainingSeconds = s.remainingSeconds;
+  deliveredMl = s.deliveredMl;
   return true;
 }
 
-void IrrigationManager::startSlaveOnly(const IrrigationCommand& cmd) {
-  if (!roleHasAnyZone(cmd)) return;
-  applyZones(cmd, true);
-  currentCmd.id = cmd.id;
-  currentCmd.status = 1; // started by slave1 only
-  currentCmd.numZones = cmd.numZones;
-  for (uint8_t i = 0; i < currentCmd.numZones; i++) currentCmd.zones[i] = cmd.zones[i];
-
-  remainingSeconds = (uint32_t)cmd.remainingMinutes * 60UL;
-  state = Running;
-  persist(true);
-  ParserServer::sendStatusUpdate(currentCmd.id, 1, cmd.remainingMinutes);
-}
-
-void IrrigationManager::startMasterBoth(const IrrigationCommand& cmd) {
-  if (!roleHasAnyZone(cmd)) return;
-  if (ROLE == ROLE_MASTER) pumpOn();
-
+void IrrigationManager::startRun(const IrrigationCommand& cmd, uint8_t status) {
+  if (ThisRole::kDrivesPump) pumpOn();
   applyZones(cmd, true);
-  currentCmd.id = cmd.id;
-  currentCmd.status = 3; // in progress (master + slaves)
-  currentCmd.numZones = cmd.numZones;
-  for (uint8_t i = 0; i < currentCmd.numZones; i++) currentCmd.zones[i] = cmd.zones[i];
+  currentCmd = cmd;
+  currentCmd.status = status;
   remainingSeconds = (uint32_t)cmd.remainingMinutes * 60UL;
+  startFlow(0);
   state = Running;
   persist(true);
-  ParserServer::sendStatusUpdate(currentCmd.id, 3, cmd.remainingMinutes);
+  reportStatus(status, cmd.remainingMinutes);
 }
 
-void IrrigationManager::stopMasterComplete(const IrrigationCommand& cmd) {
+void IrrigationManager::endRun(const IrrigationCommand& cmd, uint8_t status) {
+  // An idle MASTER still acknowledges a dashboard STOP; the ack belongs to
+  // the stopped irrigation, not to the last run
+  if (state != Running) currentCmd.id = cmd.id;
   applyZones(cmd, false);
-  if (ROLE == ROLE_MASTER) pumpOff();
-  currentCmd.status = 4; // completed by master
+  if (ThisRole::kDrivesPump) pumpOff();
+  currentCmd.status = status;
   state = Idle;
   persist(false);
-  ParserServer::sendStatusUpdate(currentCmd.id, 4, 0);
+  reportStatus(status, 0);
 }
 
-void IrrigationManager::stopSlaveComplete(const IrrigationCommand& cmd) {
-  applyZones(cmd, false);
-  // If master already completed (4), slave1 completion -> 5, slave2 both -> 6
-  if (ROLE == ROLE_SLAVE1) {
-    currentCmd.status = 5;
-  } else if (ROLE == ROLE_SLAVE2) {
-    // can't know if slave1 done; use 6 as terminal if only zones on slave2
-    currentCmd.status = 6;
-  } else {
-    currentCmd.status = 6;
+bool IrrigationManager::pumpIsSlave1(const IrrigationCommand& cmd) const {
+  for (uint8_t i = 0; i < cmd.numZones; i++) {
+    if (cmd.zones[i] == PUMP_ZONE_SLAVE1) return true;
   }
-  state = Idle;
-  persist(false);
-  ParserServer::sendStatusUpdate(currentCmd.id, currentCmd.status, 0);
+  return false;
 }
 
-void IrrigationManager::stopMasterImmediate(const IrrigationCommand& cmd) {
-  applyZones(cmd, false);
-  if (ROLE == ROLE_MASTER) pumpOff();
-  currentCmd.status = 8; // stopped by master
-  state = Idle;
-  persist(false);
-  ParserServer::sendStatusUpdate(currentCmd.id, 8, 0);
+const RoleTransition& IrrigationManager::transition(uint8_t status) const {
+  return ThisRole::transitions()[status * 2 + (state == Running ? 1 : 0)];
 }
 
-void IrrigationManager::stopSlaveAfterMaster(const IrrigationCommand& cmd) {
-  applyZones(cmd, false);
-  // after STOP: slave1 -> 9, slave2 -> 10
-  if (ROLE == ROLE_SLAVE1) currentCmd.status = 9; else currentCmd.status = 10;
-  state = Idle;
-  persist(false);
-  ParserServer::sendStatusUpdate(currentCmd.id, currentCmd.status, 0);
+bool IrrigationManager::guardAllows(uint8_t guard, const IrrigationCommand& cmd) const {
+  if (guard == GuardHasZone) return roleHasAnyZone(cmd);
+  if (guard == GuardOwnsPump) return !pumpIsSlave1(cmd);
+  return true;
+}
+
+// Start a program from the local schedule. Every board runs its own part
+// (MASTER the pump unless SLAVE1's pump zone is listed, slaves their zones)
+// and reports it as in progress; completion goes through tick() as usual.
+// The guard and the idle check come from the role's start row, exactly as
+// for a start from the server.
+bool IrrigationManager::startLocalProgram(const IrrigationCommand& cmd) {
+  if (!cmd.valid) return false;
+  const RoleTransition& t = transition(LOCAL_START_TRIGGER);
+  if (t.action != ActStart || !guardAllows(t.guard, cmd)) return false;
+  startRun(cmd, ThisRole::kStartStatus);
+  return true;
+}
+
+PollUrgency IrrigationManager::pollUrgency() const {
+  if (state == Running) {
+    // Completion (S=4) and STOP acknowledgements (S=8/9) from peers arrive
+    // right at the end of a run or right after a dashboard STOP (S=7)
+    if (remainingSeconds <= POLL_NEAR_END_S) return PollUrgent;
+    if (lastServerStatus == 7 || lastServerStatus == 8) return PollUrgent;
+    return PollActive;
+  }
+  // Waiting for a peer to move a pending command along; don't wait forever
+  if (millis() - lastServerStatusMs >= POLL_FAST_WINDOW_MS) return PollIdle;
+  // S=0: MASTER waits for the slaves' S=1/S=2, SLAVE2 for SLAVE1's S=1
+  if (ThisRole::kWaitsForPeerStart && lastServerStatus == 0 && lastServerForRole) return PollUrgent;
+  return PollIdle;
 }
 
 void IrrigationManager::onServerCommand(const IrrigationCommand& cmd) {
   if (!cmd.valid) return;
+  // A poll can list several irrigations. While one runs the others wait
+  // (their start is seen again once this one ends), and the end of another
+  // one is history: neither may touch the run in progress or the poll
+  // bookkeeping that follows it
+  // A local schedule run has no server record, so the dashboard reaches it
+  // only through the STOP of another irrigation
+  bool stopsLocalRun = state == Running && cmd.id != currentCmd.id &&
+                       currentCmd.id >= LOCAL_RUN_ID_BASE && cmd.status < STATUS_COUNT &&
+                       transition(cmd.status).action == ActStop;
+  if (state == Running && cmd.id != currentCmd.id && !stopsLocalRun) return;
+  if (cmd.status != lastServerStatus) {
+    lastServerStatus = cmd.status;
+    lastServerStatusMs = millis();
+  }
+  lastServerCmd = cmd;
+  // Whoever sees a dashboard STOP first relays it so the pump stops at once
+  if (cmd.status == 7 && peer && cmd.id != lastRelayedStopId) {
+    lastRelayedStopId = cmd.id;
+    peer->publish(cmd.id, 7, 0);
+  }
   
-  auto hasZone = [&](uint8_t z)->bool{
-    for (uint8_t i=0;i<cmd.numZones;i++) if (cmd.zones[i]==z) return true;
-    return false;
-  };
-  bool pumpIsSlave1 = hasZone(PUMP_ZONE_SLAVE1);
-
-  if (ROLE == ROLE_MASTER) {
-    // STOP takes precedence
-    if (cmd.status == 7) {
-      stopMasterImmediate(cmd);
-      return;
-    }
-    // Start pump if MASTER is pump owner (i.e., no zone5 in list)
-    if ((cmd.status == 1 || cmd.status == 2) && !pumpIsSlave1) {
-      startMasterBoth(cmd); // -> 3
-      return;
-    }
-    if (cmd.status == 0) {
-      // Do nothing; wait for slave to start if zones involve slave
-      return;
-    }
-  } else if (ROLE == ROLE_SLAVE1) {
-    if (cmd.status == 0 && roleHasAnyZone(cmd)) {
-      startSlaveOnly(cmd); // -> 1
-      return;
-    }
-    if (cmd.status == 4 && state == Running) {
-      stopSlaveComplete(cmd); // -> 5
-      return;
-    }
-    if (cmd.status == 8 && state == Running) {
-      stopSlaveAfterMaster(cmd); // -> 9
-      return;
-    }
-  } else if (ROLE == ROLE_SLAVE2) {
-    if (cmd.status == 1 && roleHasAnyZone(cmd)) {
-      // join after slave1: -> 2
-      applyZones(cmd, true);
-      currentCmd = cmd;
-      currentCmd.status = 2;
-      remainingSeconds = (uint32_t)cmd.remainingMinutes * 60UL;
-      state = Running;
-      persist(true);
-      ParserServer::sendStatusUpdate(currentCmd.id, 2, cmd.remainingMinutes);
-      return;
-    }
-    if ((cmd.status == 4 || cmd.status == 5) && state == Running) {
-      stopSlaveComplete(cmd); // -> 6
-      return;
-    }
-    if ((cmd.status == 8 || cmd.status == 9) && state == Running) {
-      stopSlaveAfterMaster(cmd); // -> 10
-      return;
-    }
+  lastServerForRole = ThisRole::kDrivesPump ? !pumpIsSlave1(cmd) : roleHasAnyZone(cmd);
+
+  if (cmd.status >= STATUS_COUNT) return;
+  if (stopsLocalRun) {
+    // Close the local run (peers follow it by its id), then move the
+    // dashboard's irrigation along the STOP chain as well
+    endRun(currentCmd, ThisRole::kStopStatus);
+    endRun(cmd, ThisRole::kStopStatus);
+    return;
+  }
+  const RoleTransition& t = transition(cmd.status);
+  if (t.action == ActStart) {
+    if (guardAllows(t.guard, cmd)) startRun(cmd, ThisRole::kStartStatus);
+  } else if (t.action == ActComplete) {
+    endRun(cmd, ThisRole::kCompleteStatus);
+  } else if (t.action == ActStop) {
+    endRun(cmd, ThisRole::kStopStatus);
   }
 }
-
-
@@ -4,33 +4,27 @@
 #include <Arduino.h>
 #include "Config.h"
 #include "Pins.h"
+#include "IrrigationCommand.h"
 #include "Sim900.h"
+#include "PeerLink.h"
+#include "FlowMeter.h"
+#include "RolePolicy.h"
 // forward declare to avoid circular include with EepromStore
 struct PersistedIrrigation;
 
-struct IrrigationCommand {
-  bool valid;
-  long id;
-  uint8_t zones[ZONES_MAX];
-  uint8_t numZones;
-  uint8_t totalMinutes;     // T
-  uint8_t remainingMinutes; // M
-  uint8_t status;           // S
-
-  IrrigationCommand(): valid(false), id(-1), numZones(0),
-      totalMinutes(0), remainingMinutes(0), status(0xFF) 
-  {
-    for (uint8_t i = 0; i < ZONES_MAX; i++) zones[i] = 0;
-  }
-};
-
 class IrrigationManager {
 public:
   explicit IrrigationManager(Sim900Client& modem);
 
   void begin(); // resume from EEPROM if available
   void tick();  // timers, periodic persistence, etc.
+  uint32_t msUntilNextTick(uint32_t now) const; // 0xFFFFFFFF when nothing is running
   void onServerCommand(const IrrigationCommand& cmd); // handle new command
+  PollUrgency pollUrgency() const; // how soon this role needs the next poll
+  bool startLocalProgram(const IrrigationCommand& cmd); // offline schedule run
+  void setPeerLink(PeerLink* link) { peer = link; }
+  void onPeerStatus(const PeerStatus& ps); // transition reported by another board
+  void setFlowMeter(FlowMeter* meter) { flow = meter; }
 
 private:
   enum RunState {
@@ -38,17 +32,20 @@ private:
     Running
   };
 
-  void startSlaveOnly(const IrrigationCommand& cmd);  // S=0 -> S=1
-  void startMasterBoth(const IrrigationCommand& cmd); // S=1 -> S=2
-  void stopMasterComplete(const IrrigationCommand& cmd); // -> S=3
-  void stopSlaveComplete(const IrrigationCommand& cmd);  // -> S=4
-  void stopMasterImmediate(const IrrigationCommand& cmd); // S=5 -> S=6
-  void stopSlaveAfterMaster(const IrrigationCommand& cmd); // S=6 -> S=7
+  // Role transitions come from ThisRole (RolePolicy.h)
+  void startRun(const IrrigationCommand& cmd, uint8_t status); // outputs on, report status
+  void endRun(const IrrigationCommand& cmd, uint8_t status);   // outputs off, report status
+  const RoleTransition& transition(uint8_t status) const;    // row for status in the current state
+  bool guardAllows(uint8_t guard, const IrrigationCommand& cmd) const;
+  bool pumpIsSlave1(const IrrigationCommand& cmd) const;
 
+  void reportStatus(uint8_t status, uint8_t remainingMinutes);
+  void startFlow(uint32_t deliveredMl);
+  void stopOnFlowFault();
   void applyZones(const IrrigationCommand& cmd, bool on);
   bool roleHasAnyZone(const IrrigationCommand& cmd) const;
   void persist(bool active);
-  bool restore();
+  bool restore(uint32_t& deliveredMl);
 
   Sim900Client& sim;
   RunState state;
@@ -56,6 +53,14 @@ private:
   uint32_t remainingSeconds;
   uint32_t lastTickMs;
   uint32_t lastPersistMs;
+  uint8_t lastServerStatus;     // S of the last command seen from the server
+  uint32_t lastServerStatusMs;  // when lastServerStatus last changed
+  bool lastServerForRole;       // that command involves this board
+  IrrigationCommand lastServerCmd;
+  PeerLink* peer;               // optional direct link to the other boards
+  long lastRelayedStopId;
+  FlowMeter* flow;              // optional, on the board that drives the pump
+  uint8_t lastFlowFault;        // reported with the stop it caused
 };
 
 #endif
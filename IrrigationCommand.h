@@ -0,0 +1,25 @@
+#ifndef IRRIGATION_COMMAND_H
+#define IRRIGATION_COMMAND_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// One irrigation record from the server (or the local schedule)
+struct IrrigationCommand {
+  bool valid;
+  long id;
+  uint8_t zones[ZONES_MAX];
+  uint8_t numZones;
+  uint8_t totalMinutes;     // T
+  uint8_t remainingMinutes; // M
+  uint8_t status;           // S
+  uint16_t targetLiters;    // L, 0 = run for the time only
+
+  IrrigationCommand(): valid(false), id(-1), numZones(0),
+      totalMinutes(0), remainingMinutes(0), status(0xFF), targetLiters(0) 
+  {
+    for (uint8_t i = 0; i < ZONES_MAX; i++) zones[i] = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "ModemJobs.h"
+
+ModemJobQueue modemJobs;
+
+static const char* const JOB_NAMES[JobKindCount] = {
+  "status", "minute", "poll", "schedule", "clock"
+};
+
+ModemJobQueue::ModemJobQueue()
+  : count(0),
+    droppedJobs(0),
+    coalescedJobs(0) {
+  for (uint8_t k = 0; k < JobKindCount; k++) {
+    kindStats[k].count = 0;
+    kindStats[k].totalDelayMs = 0;
+    kindStats[k].maxDelayMs = 0;
+  }
+}
+
+uint8_t ModemJobQueue::effectivePriority(const ModemJob& job, uint32_t now) const {
+  if (job.hasDeadline && (int32_t)(now - job.deadline) >= 0) return PrioCritical;
+  return job.priority;
+}
+
+// The merged job keeps the older one's queue position and age, and a flow
+// fault reported with the earlier status survives a later one without
+void ModemJobQueue::mergeInto(ModemJob& into, const ModemJob& newer) {
+  uint32_t enqueuedAt = into.enqueuedAt;
+  uint8_t fault = into.fault;
+  into = newer;
+  into.enqueuedAt = enqueuedAt;
+  if (!into.fault) into.fault = fault;
+}
+
+void ModemJobQueue::removeAt(uint8_t i) {
+  for (uint8_t j = i; j + 1 < count; j++) jobs[j] = jobs[j + 1];
+  count--;
+}
+
+bool ModemJobQueue::push(const ModemJob& job) {
+  // The last slot is kept for the poll, so a burst of other jobs can delay
+  // it (up to its deadline) but never keep it out of the queue
+  uint8_t limit = (job.kind == JobPoll || has(JobPoll)) ? MODEM_JOB_QUEUE_SIZE
+                                                        : MODEM_JOB_QUEUE_SIZE - 1;
+  if (count >= limit && job.kind == JobStatus) {
+    // Full: the server keeps only the latest status of an irrigation, so
+    // transitions of one id can be folded together. Update the newest
+    // queued one for this id in place...
+    for (uint8_t i = count; i > 0; i--) {
+      if (jobs[i - 1].kind != JobStatus || jobs[i - 1].id != job.id) continue;
+      mergeInto(jobs[i - 1], job);
+      coalescedJobs++;
+      return true;
+    }
+    // ...or make room by folding two queued transitions of another one
+    for (uint8_t i = 0; i < count && count >= limit; i++) {
+      if (jobs[i].kind != JobStatus) continue;
+      for (uint8_t j = i + 1; j < count; j++) {
+        if (jobs[j].kind != JobStatus || jobs[j].id != jobs[i].id) continue;
+        mergeInto(jobs[i], jobs[j]);
+        removeAt(j);
+        coalescedJobs++;
+        break;
+      }
+    }
+  }
+  if (count >= limit) {
+    // Otherwise evict the least important (newest among equals) job other
+    // than the poll if the new one outranks it, or refuse the new one
+    uint8_t worst = count;
+    for (uint8_t i = 0; i < count; i++) {
+      if (jobs[i].kind == JobPoll) continue;
+      if (worst == count || jobs[i].priority >= jobs[worst].priority) worst = i;
+    }
+    droppedJobs++;
+    if (worst == count || jobs[worst].priority <= job.priority) return false;
+    removeAt(worst);
+  }
+  jobs[count++] = job;
+  return true;
+}
+
+bool ModemJobQueue::pop(uint32_t now, ModemJob& out) {
+  if (count == 0) return false;
+  // jobs[] is in enqueue order, so the first best match is the oldest
+  uint8_t best = 0;
+  uint8_t bestPrio = effectivePriority(jobs[0], now);
+  for (uint8_t i = 1; i < count; i++) {
+    uint8_t p = effectivePriority(jobs[i], now);
+    if (p < bestPrio) {
+      best = i;
+      bestPrio = p;
+    }
+  }
+  out = jobs[best];
+  removeAt(best);
+
+  ModemJobStats& st = kindStats[out.kind];
+  uint32_t delay = now - out.enqueuedAt;
+  st.count++;
+  st.totalDelayMs += delay;
+  if (delay > st.maxDelayMs) st.maxDelayMs = delay;
+  return true;
+}
+
+bool ModemJobQueue::has(uint8_t kind) const {
+  for (uint8_t i = 0; i < count; i++) {
+    if (jobs[i].kind == kind) return true;
+  }
+  return false;
+}
+
+void ModemJobQueue::dropStatusUpdates(long id, uint8_t kind) {
+  uint8_t i = 0;
+  while (i < count) {
+    if (jobs[i].kind == kind && jobs[i].id == id) removeAt(i);
+    else i++;
+  }
+}
+
+void ModemJobQueue::printStats(Print& out) const {
+  for (uint8_t k = 0; k < JobKindCount; k++) {
+    const ModemJobStats& st = kindStats[k];
+    out.print("  job "); out.print(JOB_NAMES[k]);
+    out.print(": n="); out.print(st.count);
+    out.print(" avgDelay="); out.print(st.count ? st.totalDelayMs / st.count : 0);
+    out.print("ms maxDelay="); out.print(st.maxDelayMs); out.println("ms");
+  }
+  out.print("  queued="); out.print(count);
+  out.print(" dropped="); out.print(droppedJobs);
+  out.print(" coalesced="); out.println(coalescedJobs);
+}
@@ -0,0 +1,77 @@
+#ifndef MODEM_JOBS_H
+#define MODEM_JOBS_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Work waiting for the single SIM900 HTTP channel
+enum ModemJobKind {
+  JobStatus,    // status transition (start, completion, STOP acknowledgement)
+  JobMinute,    // periodic remaining-minutes update
+  JobPoll,      // command poll
+  JobSchedule,  // weekly schedule download
+  JobClock,     // AT+CCLK? clock sync
+  JobKindCount
+};
+
+// Lower value runs first
+enum ModemJobPriority {
+  PrioCritical,   // a job whose deadline has passed
+  PrioHigh,
+  PrioNormal,
+  PrioLow,
+  PrioBackground
+};
+
+struct ModemJob {
+  uint8_t kind;
+  uint8_t priority;
+  uint32_t enqueuedAt;
+  uint32_t deadline;    // valid if hasDeadline
+  bool hasDeadline;
+  long id;              // status jobs
+  uint8_t status;
+  uint8_t minutes;
+  uint16_t liters;      // delivered volume, flow meter boards
+  uint8_t fault;        // FlowFault, 0 if none
+};
+
+struct ModemJobStats {
+  uint32_t count;
+  uint32_t totalDelayMs; // enqueue -> dispatch
+  uint32_t maxDelayMs;
+};
+
+// Fixed-size priority queue. Jobs of equal priority run in enqueue order,
+// so status transitions for one irrigation reach the server in sequence.
+// When full, queued transitions of one irrigation are merged to make room.
+class ModemJobQueue {
+public:
+  ModemJobQueue();
+
+  bool push(const ModemJob& job);
+  bool pop(uint32_t now, ModemJob& out); // best job, deadline-expired first
+  bool has(uint8_t kind) const;
+  void dropStatusUpdates(long id, uint8_t kind); // remove queued jobs of kind for id
+  uint8_t size() const { return count; }
+
+  const ModemJobStats& stats(uint8_t kind) const { return kindStats[kind]; }
+  uint32_t dropped() const { return droppedJobs; }
+  uint32_t coalesced() const { return coalescedJobs; }
+  void printStats(Print& out) const;
+
+private:
+  uint8_t effectivePriority(const ModemJob& job, uint32_t now) const;
+  void removeAt(uint8_t i);
+  static void mergeInto(ModemJob& into, const ModemJob& newer);
+
+  ModemJob jobs[MODEM_JOB_QUEUE_SIZE];
+  uint8_t count;
+  uint32_t droppedJobs;
+  uint32_t coalescedJobs;
+  ModemJobStats kindStats[JobKindCount];
+};
+
+extern ModemJobQueue modemJobs;
+
+#endif
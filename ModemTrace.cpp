@@ -0,0 +1,195 @@
+#include "ModemTrace.h"
+
+using namespace ModemTraceFormat;
+
+namespace {
+  uint32_t recordDelta(uint8_t head, uint8_t data) {
+    if (head == kGapShort) return (uint32_t)data * kGapShortUnitMs;
+    if (head == kGapLong) return (uint32_t)data * kGapLongUnitMs;
+    return head & kDeltaMask;
+  }
+
+  bool isGap(uint8_t head) {
+    return head == kGapShort || head == kGapLong;
+  }
+
+  void printHex2(Print& out, uint8_t v) {
+    if (v < 0x10) out.print('0');
+    out.print(v, HEX);
+  }
+}
+
+ModemTrace::ModemTrace()
+  : inner(NULL),
+    enabled(MODEM_TRACE_RECORDS > 0),
+    lastStampMs(0),
+    baseMs(0),
+    count(0),
+    dropped(0) {
+}
+
+void ModemTrace::begin(Stream& modem) {
+  inner = &modem;
+  clear();
+}
+
+void ModemTrace::clear() {
+  lastStampMs = millis();
+  baseMs = lastStampMs;
+  count = 0;
+  dropped = 0;
+}
+
+void ModemTrace::push(uint8_t h, uint8_t data) {
+#if MODEM_TRACE_RECORDS > 0
+  // Full: keep the capture from its start, which is what a replay needs
+  if (count == MODEM_TRACE_RECORDS) {
+    dropped++;
+    return;
+  }
+  ring[count][0] = h;
+  ring[count][1] = data;
+  count++;
+#else
+  (void)h;
+  (void)data;
+#endif
+}
+
+void ModemTrace::record(uint8_t dir, uint8_t data) {
+  if (!enabled || MODEM_TRACE_RECORDS == 0) return;
+  uint32_t delta = millis() - lastStampMs;
+  while (delta >= kGapLongUnitMs) {
+    uint32_t n = delta / kGapLongUnitMs;
+    if (n > 255) n = 255;
+    push(kGapLong, (uint8_t)n);
+    delta -= n * kGapLongUnitMs;
+    lastStampMs += n * kGapLongUnitMs;
+  }
+  if (delta >= kGapShortUnitMs) {
+    uint32_t n = delta / kGapShortUnitMs;
+    push(kGapShort, (uint8_t)n);
+    delta -= n * kGapShortUnitMs;
+    lastStampMs += n * kGapShortUnitMs;
+  }
+  // 127 is reserved for gaps; the 1 ms left over is carried to the next record
+  if (delta > kMaxDelta) delta = kMaxDelta;
+  push((uint8_t)(dir | delta), data);
+  lastStampMs += delta;
+}
+
+void ModemTrace::dump(Print& out) const {
+  out.print("# modem-trace v1 base=");
+  out.print(baseMs);
+  out.print(" records=");
+  out.print(count);
+  out.print(" dropped=");
+  out.println(dropped);
+#if MODEM_TRACE_RECORDS > 0
+  for (uint16_t i = 0; i < count; i++) {
+    printHex2(out, ring[i][0]);
+    printHex2(out, ring[i][1]);
+    if ((i % 16) == 15 || i + 1 == count) out.println();
+    else out.print(' ');
+  }
+#endif
+  out.println("# end");
+}
+
+int ModemTrace::available() {
+  return inner ? inner->available() : 0;
+}
+
+int ModemTrace::read() {
+  if (!inner) return -1;
+  int c = inner->read();
+  if (c >= 0) record(0, (uint8_t)c);
+  return c;
+}
+
+int ModemTrace::peek() {
+  return inner ? inner->peek() : -1;
+}
+
+size_t ModemTrace::write(uint8_t b) {
+  if (!inner) return 0;
+  record(kDirTx, b);
+  return inner->write(b);
+}
+
+size_t ModemTrace::write(const uint8_t* buf, size_t len) {
+  size_t n = 0;
+  for (size_t i = 0; i < len; i++) n += write(buf[i]);
+  return n;
+}
+
+void ModemTrace::flush() {
+  if (inner) inner->flush();
+}
+
+// --- Replay ---
+
+ModemTraceReplay::ModemTraceReplay(const uint8_t* records, size_t recordCount, uint32_t baseMs)
+  : data(records),
+    total(recordCount),
+    pos(0),
+    clockMs(baseMs),
+    txMismatches(0),
+    txAfterEnd(0) {
+}
+
+void ModemTraceReplay::skipGaps() {
+  while (pos < total && isGap(data[pos * 2])) {
+    clockMs += recordDelta(data[pos * 2], data[pos * 2 + 1]);
+    pos++;
+  }
+}
+
+uint32_t ModemTraceReplay::stampAt(size_t i) const {
+  return clockMs + recordDelta(data[i * 2], data[i * 2 + 1]);
+}
+
+uint32_t ModemTraceReplay::nextEventMs() {
+  skipGaps();
+  if (finished()) return clockMs;
+  return stampAt(pos);
+}
+
+int ModemTraceReplay::available() {
+  skipGaps();
+  if (finished()) return 0;
+  // A recorded write must happen before anything the modem sent after it
+  if (data[pos * 2] & kDirTx) return 0;
+  return (int32_t)(millis() - stampAt(pos)) >= 0 ? 1 : 0;
+}
+
+int ModemTraceReplay::peek() {
+  if (!available()) return -1;
+  return data[pos * 2 + 1];
+}
+
+int ModemTraceReplay::read() {
+  if (!available()) return -1;
+  uint8_t c = data[pos * 2 + 1];
+  clockMs = stampAt(pos);
+  pos++;
+  return c;
+}
+
+size_t ModemTraceReplay::write(uint8_t b) {
+  skipGaps();
+  if (finished()) {
+    // Past the end: a divergence, unless the capture was cut short
+    txAfterEnd++;
+    return 1;
+  }
+  if (!(data[pos * 2] & kDirTx)) {
+    // The board sent something the capture never saw
+    txMismatches++;
+    return 1;
+  }
+  if (data[pos * 2 + 1] != b) txMismatches++;
+  clockMs = stampAt(pos);
+  pos++;
+  return 1;
+}
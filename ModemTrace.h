@@ -0,0 +1,95 @@
+#ifndef MODEM_TRACE_H
+#define MODEM_TRACE_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Compact binary trace of SIM900 traffic.
+// Each record is 2 bytes: [head, data].
+//   head bit7     : direction (0 = modem -> board, 1 = board -> modem)
+//   head bits0..6 : ms elapsed since the previous record (0..126)
+// Two head values are reserved for clock gaps (data carries the gap length):
+//   0x7F : advance clock by data * 128 ms
+//   0xFF : advance clock by data * 32768 ms
+namespace ModemTraceFormat {
+  static const uint8_t kDirTx = 0x80;
+  static const uint8_t kDeltaMask = 0x7F;
+  static const uint8_t kMaxDelta = 126;
+  static const uint8_t kGapShort = 0x7F;
+  static const uint8_t kGapLong = 0xFF;
+  static const uint32_t kGapShortUnitMs = 128UL;
+  static const uint32_t kGapLongUnitMs = 32768UL;
+}
+
+// Stream wrapper placed between Sim900Client and the modem serial port.
+// Every byte read or written is recorded into a RAM buffer until it is
+// full; later records are only counted (dropped), so a capture always
+// starts where it was begun or cleared.
+class ModemTrace : public Stream {
+public:
+  ModemTrace();
+  void begin(Stream& modem);
+
+  void setEnabled(bool on) { enabled = on; }
+  void clear();
+  void dump(Print& out) const; // hex dump, one "#"-prefixed header line
+
+  // Stream
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t* buf, size_t len);
+  void flush();
+  using Print::write;
+
+private:
+  void record(uint8_t dir, uint8_t data);
+  void push(uint8_t head, uint8_t data);
+
+  Stream* inner;
+  bool enabled;
+  uint32_t lastStampMs; // clock as encoded so far
+  uint32_t baseMs;      // timestamp the capture starts from
+  uint16_t count;
+  uint32_t dropped;     // records not kept because the buffer was full
+#if MODEM_TRACE_RECORDS > 0
+  uint8_t ring[MODEM_TRACE_RECORDS][2];
+#endif
+};
+
+// Replays a captured trace as if it were the modem.
+// Bytes the board received are released once millis() reaches their
+// timestamp and the board has written every byte recorded before them,
+// so a host build that drives millis() gets a deterministic re-run of
+// Sim900Client::loop(). Written bytes are compared against the capture.
+class ModemTraceReplay : public Stream {
+public:
+  ModemTraceReplay(const uint8_t* records, size_t recordCount, uint32_t baseMs);
+
+  bool finished() const { return pos >= total; }
+  uint32_t mismatches() const { return txMismatches; }
+  uint32_t writtenAfterEnd() const { return txAfterEnd; }
+  uint32_t nextEventMs(); // when the next modem byte becomes readable
+
+  // Stream
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t b);
+  void flush() {}
+  using Print::write;
+
+private:
+  void skipGaps();
+  uint32_t stampAt(size_t i) const;
+
+  const uint8_t* data;
+  size_t total;
+  size_t pos;          // index of the next unconsumed record
+  uint32_t clockMs;    // timestamp of the last consumed record
+  uint32_t txMismatches;
+  uint32_t txAfterEnd;
+};
+
+#endif
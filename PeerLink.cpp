@@ -0,0 +1,207 @@
+#include "PeerLink.h"
+
+static const uint8_t FRAME_SYNC = 0x7E;
+static const uint8_t TYPE_STATUS = 'S';
+static const uint8_t TYPE_ACK = 'A';
+static const uint8_t ALL_ROLES = (1 << ROLE_MASTER) | (1 << ROLE_SLAVE1) | (1 << ROLE_SLAVE2);
+
+PeerLink::PeerLink(uint8_t selfRole)
+  : self(selfRole),
+    peerMask((uint8_t)(ALL_ROLES & ~(1 << selfRole))),
+    port(NULL),
+    rxLen(0),
+    outActive(false),
+    outSeq(0),
+    outId(0),
+    outStatus(0),
+    outMinutes(0),
+    outPendingMask(0),
+    outTries(0),
+    outSentAt(0),
+    outLastTxAt(0),
+    inboxFull(false),
+    inbox(),
+    statSent(0),
+    statRetransmits(0),
+    statLost(0),
+    statCrcErrors(0),
+    statLastRttMs(0),
+    statMaxRttMs(0) {
+  for (uint8_t i = 0; i < 4; i++) {
+    ackPending[i] = false;
+    ackSeq[i] = 0;
+    ackDueAt[i] = 0;
+    lastSeqFrom[i] = 0;
+    lastCrcFrom[i] = 0;
+    seenFrom[i] = false;
+  }
+}
+
+void PeerLink::begin(Stream& portRef) {
+  port = &portRef;
+  if (PEER_LINK_DE_PIN >= 0) {
+    pinMode(PEER_LINK_DE_PIN, OUTPUT);
+    digitalWrite(PEER_LINK_DE_PIN, LOW); // receive
+  }
+}
+
+uint8_t PeerLink::crc8(const uint8_t* p, uint8_t len) {
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < len; i++) {
+    crc ^= p[i];
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+void PeerLink::sendFrame(uint8_t type, uint8_t seq, long id, uint8_t status, uint8_t minutes) {
+  if (!port) return;
+  uint8_t f[kFrameLen];
+  uint32_t uid = (uint32_t)id;
+  f[0] = FRAME_SYNC;
+  f[1] = self;
+  f[2] = seq;
+  f[3] = type;
+  f[4] = (uint8_t)uid;
+  f[5] = (uint8_t)(uid >> 8);
+  f[6] = (uint8_t)(uid >> 16);
+  f[7] = (uint8_t)(uid >> 24);
+  f[8] = status;
+  f[9] = minutes;
+  f[10] = crc8(f + 1, kFrameLen - 2);
+  // Half-duplex transceiver: drive the bus only while sending
+  if (PEER_LINK_DE_PIN >= 0) digitalWrite(PEER_LINK_DE_PIN, HIGH);
+  port->write(f, kFrameLen);
+  port->flush();
+  if (PEER_LINK_DE_PIN >= 0) digitalWrite(PEER_LINK_DE_PIN, LOW);
+}
+
+void PeerLink::publish(long id, uint8_t status, uint8_t minutes) {
+  if (!port) return;
+  if (outActive && outPendingMask) statLost++; // superseded before every peer acked
+  outActive = true;
+  outSeq++;
+  outId = id;
+  outStatus = status;
+  outMinutes = minutes;
+  outPendingMask = peerMask;
+  outTries = 1;
+  outSentAt = millis();
+  outLastTxAt = outSentAt;
+  statSent++;
+  sendFrame(TYPE_STATUS, outSeq, id, status, minutes);
+}
+
+bool PeerLink::receive(PeerStatus& out) {
+  if (!inboxFull) return false;
+  out = inbox;
+  inboxFull = false;
+  return true;
+}
+
+void PeerLink::onFrame(const uint8_t* f) {
+  uint8_t src = f[1];
+  if (src == self || src > ROLE_SLAVE2 || src == 0) return;
+  uint8_t seq = f[2];
+  if (f[3] == TYPE_ACK) {
+    // Every board acks on the shared bus; only acks of our own status count
+    if (f[8] != self || !outActive || seq != outSeq) return;
+    outPendingMask &= (uint8_t)~(1 << src);
+    if (outPendingMask == 0) {
+      outActive = false;
+      statLastRttMs = millis() - outSentAt;
+      if (statLastRttMs > statMaxRttMs) statMaxRttMs = statLastRttMs;
+    }
+    return;
+  }
+  if (f[3] != TYPE_STATUS) return;
+
+  // Acknowledge every copy (our previous ack may be the one that got lost),
+  // each role in its own time slot so acks don't collide on the bus
+  ackPending[src] = true;
+  ackSeq[src] = seq;
+  ackDueAt[src] = millis() + (uint32_t)(self - 1) * PEER_LINK_SLOT_MS;
+
+  uint8_t crc = f[kFrameLen - 1];
+  if (seenFrom[src] && lastSeqFrom[src] == seq && lastCrcFrom[src] == crc) return; // retransmission
+  seenFrom[src] = true;
+  lastSeqFrom[src] = seq;
+  lastCrcFrom[src] = crc;
+  inbox.from = src;
+  inbox.id = (long)((uint32_t)f[4] | ((uint32_t)f[5] << 8) |
+                    ((uint32_t)f[6] << 16) | ((uint32_t)f[7] << 24));
+  inbox.status = f[8];
+  inbox.minutes = f[9];
+  inboxFull = true;
+}
+
+void PeerLink::loop() {
+  if (!port) return;
+  // Stop at a delivered status so the single inbox slot is never overwritten
+  while (!inboxFull && port->available()) {
+    uint8_t c = (uint8_t)port->read();
+    if (rxLen == 0 && c != FRAME_SYNC) continue;
+    rx[rxLen++] = c;
+    if (rxLen < kFrameLen) continue;
+    rxLen = 0;
+    if (crc8(rx + 1, kFrameLen - 2) == rx[kFrameLen - 1]) {
+      onFrame(rx);
+    } else {
+      statCrcErrors++;
+      // resynchronise on the next sync byte inside the bad frame
+      for (uint8_t i = 1; i < kFrameLen; i++) {
+        if (rx[i] == FRAME_SYNC) {
+          for (uint8_t j = i; j < kFrameLen; j++) rx[rxLen++] = rx[j];
+          break;
+        }
+      }
+    }
+  }
+
+  uint32_t now = millis();
+  for (uint8_t src = ROLE_MASTER; src <= ROLE_SLAVE2; src++) {
+    if (!ackPending[src] || (int32_t)(now - ackDueAt[src]) < 0) continue;
+    ackPending[src] = false;
+    sendFrame(TYPE_ACK, ackSeq[src], 0, src, 0);
+  }
+
+  if (outActive && now - outLastTxAt >= PEER_LINK_RETRY_MS) {
+    if (outTries >= PEER_LINK_RETRIES) {
+      // Peers that never answered will pick the status up from the server
+      outActive = false;
+      statLost++;
+      return;
+    }
+    outTries++;
+    outLastTxAt = now;
+    statRetransmits++;
+    sendFrame(TYPE_STATUS, outSeq, outId, outStatus, outMinutes);
+  }
+}
+
+uint32_t PeerLink::msUntilNextEvent(uint32_t now) const {
+  uint32_t wait = 0xFFFFFFFFUL;
+  for (uint8_t src = ROLE_MASTER; src <= ROLE_SLAVE2; src++) {
+    if (!ackPending[src]) continue;
+    int32_t d = (int32_t)(ackDueAt[src] - now);
+    uint32_t due = d > 0 ? (uint32_t)d : 0;
+    if (due < wait) wait = due;
+  }
+  if (outActive) {
+    uint32_t elapsed = now - outLastTxAt;
+    uint32_t d = elapsed >= PEER_LINK_RETRY_MS ? 0 : PEER_LINK_RETRY_MS - elapsed;
+    if (d < wait) wait = d;
+  }
+  return wait;
+}
+
+void PeerLink::printStats(Print& out) const {
+  out.print("["); out.print(ROLE_NAME); out.print("] peer sent="); out.print(statSent);
+  out.print(" retx="); out.print(statRetransmits);
+  out.print(" lost="); out.print(statLost);
+  out.print(" crcErr="); out.print(statCrcErrors);
+  out.print(" rtt="); out.print(statLastRttMs);
+  out.print("ms max="); out.print(statMaxRttMs); out.println("ms");
+}
@@ -0,0 +1,82 @@
+#ifndef PEER_LINK_H
+#define PEER_LINK_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Direct board-to-board link (RS-485 on a spare hardware UART) that carries
+// status transitions between MASTER, SLAVE1 and SLAVE2 in milliseconds.
+// The server stays the source of truth; this only shortens the wait for
+// the next poll.
+//
+// Frame (11 bytes): 0x7E src seq type id[4, LE] status minutes crc8
+//   src   : sender's ROLE value
+//   type  : 'S' status, 'A' acknowledgement
+//   ack   : seq = acked seq, status = ROLE of the status sender, id/minutes 0
+//   crc8  : CRC-8 (poly 0x07) over src..minutes
+struct PeerStatus {
+  uint8_t from;
+  long id;
+  uint8_t status;
+  uint8_t minutes;
+};
+
+class PeerLink {
+public:
+  explicit PeerLink(uint8_t selfRole = ROLE);
+  void begin(Stream& port);
+  void loop();
+
+  void publish(long id, uint8_t status, uint8_t minutes); // newest supersedes unacked
+  bool receive(PeerStatus& out);
+  uint32_t msUntilNextEvent(uint32_t now) const; // next retransmit or ack, 0xFFFFFFFF if none
+  void printStats(Print& out) const;
+
+private:
+  static const uint8_t kFrameLen = 11;
+
+  void sendFrame(uint8_t type, uint8_t seq, long id, uint8_t status, uint8_t minutes);
+  void onFrame(const uint8_t* f);
+  static uint8_t crc8(const uint8_t* p, uint8_t len);
+
+  uint8_t self;           // this board's ROLE
+  uint8_t peerMask;       // bit per other ROLE
+  Stream* port;
+  uint8_t rx[kFrameLen];
+  uint8_t rxLen;
+
+  // outgoing status awaiting acknowledgement
+  bool outActive;
+  uint8_t outSeq;
+  long outId;
+  uint8_t outStatus;
+  uint8_t outMinutes;
+  uint8_t outPendingMask; // bit per peer ROLE still to acknowledge
+  uint8_t outTries;
+  uint32_t outSentAt;     // first transmission
+  uint32_t outLastTxAt;
+
+  // acknowledgement per sender, sent once our reply slot comes up
+  bool ackPending[4];
+  uint8_t ackSeq[4];
+  uint32_t ackDueAt[4];
+
+  // last delivered frame per sender, to drop retransmitted duplicates.
+  // A retransmission repeats seq and CRC; a peer that rebooted restarts
+  // its seq but its new status differs, so it is not taken for one.
+  uint8_t lastSeqFrom[4];
+  uint8_t lastCrcFrom[4];
+  bool seenFrom[4];
+
+  bool inboxFull;
+  PeerStatus inbox;
+
+  uint32_t statSent;
+  uint32_t statRetransmits;
+  uint32_t statLost;       // gave up after PEER_LINK_RETRIES or superseded
+  uint32_t statCrcErrors;
+  uint32_t statLastRttMs;
+  uint32_t statMaxRttMs;
+};
+
+#endif
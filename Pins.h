@@ -55,6 +55,11 @@ static inline void pumpOff() {
   digitalWrite(PUMP_PIN, HIGH);
 }
 
+static inline void allOutputsOff() {
+  for (uint8_t z = 1; z <= ZONES_MAX; z++) zoneOff(z);
+  if (ROLE == ROLE_MASTER) pumpOff();
+}
+
 #endif
 
 
@@ -0,0 +1,65 @@
+#include "PollScheduler.h"
+
+static const uint32_t HOUR_MS = 3600000UL;
+
+PollScheduler::PollScheduler()
+  : urgency(PollIdle),
+    wakePending(false),
+    polledOnce(false),
+    lastPollAt(0),
+    idleInterval(POLL_INTERVAL_MS),
+    windowStart(0),
+    windowCount(0) {
+}
+
+uint32_t PollScheduler::interval() const {
+  if (urgency == PollUrgent) return POLL_FAST_INTERVAL_MS;
+  if (urgency == PollActive) return POLL_INTERVAL_MS;
+  return idleInterval;
+}
+
+bool PollScheduler::underHourlyCap(uint32_t now) const {
+  if (now - windowStart >= HOUR_MS) return true; // window expired
+  return windowCount < POLL_MAX_PER_HOUR;
+}
+
+uint32_t PollScheduler::msUntilDue(uint32_t now) const {
+  uint32_t wait = 0;
+  if (polledOnce && !wakePending) {
+    uint32_t elapsed = now - lastPollAt;
+    uint32_t iv = interval();
+    if (elapsed < iv) wait = iv - elapsed;
+  }
+  if (!underHourlyCap(now)) {
+    uint32_t capWait = HOUR_MS - (now - windowStart);
+    if (capWait > wait) wait = capWait;
+  }
+  return wait;
+}
+
+bool PollScheduler::due(uint32_t now) const {
+  return msUntilDue(now) == 0;
+}
+
+void PollScheduler::onPollStarted(uint32_t now) {
+  if (now - windowStart >= HOUR_MS) {
+    windowStart = now;
+    windowCount = 0;
+  }
+  windowCount++;
+  wakePending = false;
+  lastPollAt = now;
+  polledOnce = true;
+}
+
+void PollScheduler::onPollResult(bool changed) {
+  if (changed) {
+    idleInterval = POLL_INTERVAL_MS;
+    return;
+  }
+  // With push wake-up the server can reach us between polls, so idle
+  // polling only has to catch missed pushes
+  uint32_t ceiling = PUSH_WAKE_ENABLED ? POLL_IDLE_MAX_INTERVAL_PUSH_MS : POLL_IDLE_MAX_INTERVAL_MS;
+  uint32_t next = idleInterval * 2;
+  idleInterval = next > ceiling ? ceiling : next;
+}
@@ -0,0 +1,40 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// How soon the irrigation logic needs to hear from the server
+enum PollUrgency {
+  PollIdle,    // nothing going on: back off
+  PollActive,  // a run is in progress: regular interval
+  PollUrgent   // a peer transition is expected or a run is about to end
+};
+
+// Decides when the next command poll is due.
+// All timing uses elapsed-time subtraction so it survives millis() wraparound.
+class PollScheduler {
+public:
+  PollScheduler();
+
+  void setUrgency(PollUrgency u) { urgency = u; }
+  void requestImmediate() { wakePending = true; } // pushed by SMS / missed call
+  bool due(uint32_t now) const;
+  uint32_t msUntilDue(uint32_t now) const;
+  void onPollStarted(uint32_t now);
+  void onPollResult(bool changed); // changed: command differs from the previous poll
+  uint32_t interval() const;
+
+private:
+  bool underHourlyCap(uint32_t now) const;
+
+  PollUrgency urgency;
+  bool wakePending;
+  bool polledOnce;
+  uint32_t lastPollAt;
+  uint32_t idleInterval;  // grows while polls keep returning the same command
+  uint32_t windowStart;   // start of the current hourly budget window
+  uint16_t windowCount;   // polls started in the current window
+};
+
+#endif
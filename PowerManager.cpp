@@ -0,0 +1,80 @@
+#include "PowerManager.h"
+#include "Watchdog.h"
+#include <avr/sleep.h>
+
+PowerManager::PowerManager()
+  : watchedCount(0),
+    lastAccountMs(0),
+    totalMs(0),
+    sleepMs(0),
+    pendingSleepMs(0),
+    modemBusyMs(0),
+    lastModemBusy(false) {
+  for (uint8_t i = 0; i < 3; i++) watched[i] = NULL;
+}
+
+void PowerManager::watch(Stream& s) {
+  if (watchedCount < 3) watched[watchedCount++] = &s;
+}
+
+bool PowerManager::inputPending() const {
+  for (uint8_t i = 0; i < watchedCount; i++) {
+    if (watched[i]->available()) return true;
+  }
+  return false;
+}
+
+// The interval since the last call is charged to the modem state seen at
+// its start, and the sleep taken in it is added only now, so a long sleep
+// ending in a transaction is not billed as busy and sleepMs <= totalMs
+void PowerManager::account(bool modemBusy) {
+  uint32_t now = millis();
+  if (lastAccountMs != 0) {
+    uint32_t dt = now - lastAccountMs;
+    totalMs += dt;
+    if (lastModemBusy) modemBusyMs += dt;
+    sleepMs += pendingSleepMs;
+  }
+  pendingSleepMs = 0;
+  lastModemBusy = modemBusy;
+  lastAccountMs = now;
+}
+
+void PowerManager::idle(uint32_t maxMs) {
+  if (maxMs > LOW_POWER_MAX_IDLE_MS) maxMs = LOW_POWER_MAX_IDLE_MS;
+  if (maxMs < LOW_POWER_MIN_IDLE_MS) return;
+  uint32_t start = millis();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (millis() - start < maxMs && !inputPending()) {
+    sleep_enable();
+    sleep_cpu();   // returns after the next interrupt
+    sleep_disable();
+    watchdog.service();
+  }
+  pendingSleepMs += millis() - start;
+}
+
+// Daily energy is extrapolated from the fractions observed so far using the
+// supply currents in Config.h: I = f_awake * I_active + f_sleep * I_idle for
+// the MCU, and the same for the modem with its busy/slow-clock currents.
+uint32_t PowerManager::mAhPerDay() const {
+  if (totalMs == 0) return 0;
+  uint64_t awake = totalMs - sleepMs;
+  uint64_t idleModem = totalMs - modemBusyMs;
+  // uA*ms, then scaled to mAh per 24 h
+  uint64_t mcu = awake * MCU_ACTIVE_UA + (uint64_t)sleepMs * MCU_IDLE_UA;
+  uint64_t modem = (uint64_t)modemBusyMs * MODEM_ACTIVE_UA + idleModem * MODEM_SLEEP_UA;
+  return (uint32_t)((mcu + modem) * 24ULL / totalMs / 1000ULL);
+}
+
+void PowerManager::printStats(Print& out) const {
+  out.print("[power] up="); out.print(totalMs / 1000);
+  out.print("s mcuSleep="); out.print(totalMs ? (uint32_t)((uint64_t)sleepMs * 100 / totalMs) : 0);
+  out.print("% modemBusy="); out.print(totalMs ? (uint32_t)((uint64_t)modemBusyMs * 100 / totalMs) : 0);
+  out.print("%");
+  if (totalMs == 0) {
+    out.println();
+    return;
+  }
+  out.print(" est="); out.print(mAhPerDay()); out.println("mAh/day");
+}
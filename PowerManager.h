@@ -0,0 +1,37 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Puts the AVR into idle sleep between loop() passes until the next known
+// deadline or until a watched serial port has input. Timer0 keeps running
+// in idle mode, so millis() stays correct and the CPU wakes every ~1 ms to
+// re-check; UART and SoftwareSerial pin-change interrupts wake it at once.
+// Also keeps the awake/asleep accounting behind the daily energy estimate.
+class PowerManager {
+public:
+  PowerManager();
+  void watch(Stream& s); // input on s ends a sleep (up to 3 streams)
+  void account(bool modemBusy); // call once per loop()
+  void idle(uint32_t maxMs);
+  void printStats(Print& out) const;
+  uint32_t coveredMs() const { return totalMs; }
+  uint32_t sleptMs() const { return sleepMs; }
+  uint32_t modemBusyTime() const { return modemBusyMs; }
+  uint32_t mAhPerDay() const; // extrapolated from the time covered so far
+
+private:
+  bool inputPending() const;
+
+  Stream* watched[3];
+  uint8_t watchedCount;
+  uint32_t lastAccountMs;
+  uint32_t totalMs;       // time covered by account()
+  uint32_t sleepMs;       // part of it spent in idle sleep
+  uint32_t pendingSleepMs; // slept since the last account()
+  uint32_t modemBusyMs;   // part of it with the modem out of slow-clock
+  bool lastModemBusy;     // modem state at the last account()
+};
+
+#endif
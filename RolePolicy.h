@@ -0,0 +1,209 @@
+#ifndef ROLE_POLICY_H
+#define ROLE_POLICY_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Status protocol per role, fixed at compile time. Each role has one row per
+// (incoming server status, local run state); IrrigationManager looks the row
+// up and runs its action. A local schedule start uses the same row as the
+// server status that starts the role. Only the table of the role being built is used, so
+// the others never reach flash. The static_asserts below keep the tables
+// complete and the protocol free of conflicts.
+
+static const uint8_t STATUS_COUNT = 11; // S=0..10, see TESTING.md
+
+enum RoleAction {
+  ActIgnore,
+  ActStart,          // open this board's zones (and pump), report kStartStatus; idle rows only
+  ActComplete,       // close them, report kCompleteStatus
+  ActStop            // close them, report kStopStatus
+};
+
+enum RoleGuard {
+  GuardNone,
+  GuardHasZone,      // the command lists a zone wired to this board
+  GuardOwnsPump      // no zone 5 in the command: the MASTER pump runs
+};
+
+struct RoleTransition {
+  uint8_t status;    // incoming S
+  uint8_t running;   // local state: 0 idle, 1 running
+  uint8_t action;    // RoleAction
+  uint8_t guard;     // RoleGuard
+};
+
+#define ROLE_ROW(s, r, a, g) { s, r, a, g }
+
+// MASTER: drives the pump, owns timing unless SLAVE1's pump (zone 5) runs
+static constexpr RoleTransition MASTER_TRANSITIONS[] = {
+  ROLE_ROW(0,  0, ActIgnore,   GuardNone),     ROLE_ROW(0,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(1,  0, ActStart,    GuardOwnsPump), ROLE_ROW(1,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(2,  0, ActStart,    GuardOwnsPump), ROLE_ROW(2,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(3,  0, ActIgnore,   GuardNone),     ROLE_ROW(3,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(4,  0, ActIgnore,   GuardNone),     ROLE_ROW(4,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(5,  0, ActIgnore,   GuardNone),     ROLE_ROW(5,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(6,  0, ActIgnore,   GuardNone),     ROLE_ROW(6,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(7,  0, ActStop,     GuardNone),     ROLE_ROW(7,  1, ActStop,     GuardNone),
+  ROLE_ROW(8,  0, ActIgnore,   GuardNone),     ROLE_ROW(8,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(9,  0, ActIgnore,   GuardNone),     ROLE_ROW(9,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(10, 0, ActIgnore,   GuardNone),     ROLE_ROW(10, 1, ActIgnore,   GuardNone)
+};
+
+// SLAVE1: starts first; zone 5 is its own pump
+static constexpr RoleTransition SLAVE1_TRANSITIONS[] = {
+  ROLE_ROW(0,  0, ActStart,    GuardHasZone),  ROLE_ROW(0,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(1,  0, ActIgnore,   GuardNone),     ROLE_ROW(1,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(2,  0, ActIgnore,   GuardNone),     ROLE_ROW(2,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(3,  0, ActIgnore,   GuardNone),     ROLE_ROW(3,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(4,  0, ActIgnore,   GuardNone),     ROLE_ROW(4,  1, ActComplete, GuardNone),
+  ROLE_ROW(5,  0, ActIgnore,   GuardNone),     ROLE_ROW(5,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(6,  0, ActIgnore,   GuardNone),     ROLE_ROW(6,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(7,  0, ActIgnore,   GuardNone),     ROLE_ROW(7,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(8,  0, ActIgnore,   GuardNone),     ROLE_ROW(8,  1, ActStop,     GuardNone),
+  ROLE_ROW(9,  0, ActIgnore,   GuardNone),     ROLE_ROW(9,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(10, 0, ActIgnore,   GuardNone),     ROLE_ROW(10, 1, ActIgnore,   GuardNone)
+};
+
+// SLAVE2: zones only, joins after SLAVE1
+static constexpr RoleTransition SLAVE2_TRANSITIONS[] = {
+  ROLE_ROW(0,  0, ActIgnore,   GuardNone),     ROLE_ROW(0,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(1,  0, ActStart,    GuardHasZone),  ROLE_ROW(1,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(2,  0, ActIgnore,   GuardNone),     ROLE_ROW(2,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(3,  0, ActIgnore,   GuardNone),     ROLE_ROW(3,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(4,  0, ActIgnore,   GuardNone),     ROLE_ROW(4,  1, ActComplete, GuardNone),
+  ROLE_ROW(5,  0, ActIgnore,   GuardNone),     ROLE_ROW(5,  1, ActComplete, GuardNone),
+  ROLE_ROW(6,  0, ActIgnore,   GuardNone),     ROLE_ROW(6,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(7,  0, ActIgnore,   GuardNone),     ROLE_ROW(7,  1, ActIgnore,   GuardNone),
+  ROLE_ROW(8,  0, ActIgnore,   GuardNone),     ROLE_ROW(8,  1, ActStop,     GuardNone),
+  ROLE_ROW(9,  0, ActIgnore,   GuardNone),     ROLE_ROW(9,  1, ActStop,     GuardNone),
+  ROLE_ROW(10, 0, ActIgnore,   GuardNone),     ROLE_ROW(10, 1, ActIgnore,   GuardNone)
+};
+
+#undef ROLE_ROW
+
+template <uint8_t Role> struct RolePolicy;
+
+template <> struct RolePolicy<ROLE_MASTER> {
+  static constexpr const RoleTransition* transitions() { return MASTER_TRANSITIONS; }
+  static constexpr bool kDrivesPump = true;
+  static constexpr bool kWaitsForPeerStart = true;     // fast polls on S=0
+  static constexpr uint8_t kStartStatus = 3;
+  static constexpr uint8_t kCompleteStatus = 4;
+  static constexpr uint8_t kStopStatus = 8;
+  static constexpr uint16_t kResumeMask = 1U << 3;     // statuses that reopen outputs after reset
+};
+
+template <> struct RolePolicy<ROLE_SLAVE1> {
+  static constexpr const RoleTransition* transitions() { return SLAVE1_TRANSITIONS; }
+  static constexpr bool kDrivesPump = false;           // its pump is zone 5
+  static constexpr bool kWaitsForPeerStart = false;
+  static constexpr uint8_t kStartStatus = 1;
+  static constexpr uint8_t kCompleteStatus = 5;
+  static constexpr uint8_t kStopStatus = 9;
+  static constexpr uint16_t kResumeMask = (1U << 1) | (1U << 2) | (1U << 3);
+};
+
+template <> struct RolePolicy<ROLE_SLAVE2> {
+  static constexpr const RoleTransition* transitions() { return SLAVE2_TRANSITIONS; }
+  static constexpr bool kDrivesPump = false;
+  static constexpr bool kWaitsForPeerStart = true;
+  static constexpr uint8_t kStartStatus = 2;
+  static constexpr uint8_t kCompleteStatus = 6;
+  static constexpr uint8_t kStopStatus = 10;
+  static constexpr uint16_t kResumeMask = (1U << 2) | (1U << 3);
+};
+
+// --- Compile-time checks (C++11 constexpr: one expression, recursion) ---
+
+// Complete and unambiguous: row i is (S = i / 2, running = i % 2), so every
+// combination appears exactly once and lookup is a plain index
+static constexpr bool rowsInOrder(const RoleTransition* t, uint8_t i) {
+  return i == STATUS_COUNT * 2 ||
+         (t[i].status == i / 2 && t[i].running == i % 2 && rowsInOrder(t, i + 1));
+}
+
+// Guards only make sense on a start, and every start needs one
+static constexpr bool guardsMatch(const RoleTransition* t, uint8_t i) {
+  return i == STATUS_COUNT * 2 ||
+         (((t[i].action == ActStart) == (t[i].guard != GuardNone)) && guardsMatch(t, i + 1));
+}
+
+// A start while running would open a second run over the first one
+static constexpr bool startsOnlyWhenIdle(const RoleTransition* t, uint8_t i) {
+  return i == STATUS_COUNT * 2 ||
+         ((t[i].action != ActStart || t[i].running == 0) && startsOnlyWhenIdle(t, i + 1));
+}
+
+// The first status that starts the role (0xFF if none)
+static constexpr uint8_t startTrigger(const RoleTransition* t, uint8_t i) {
+  return i == STATUS_COUNT * 2 ? 0xFF
+       : t[i].action == ActStart ? t[i].status
+       : startTrigger(t, i + 1);
+}
+
+// Every start row has the same guard, so a local start can take any of them
+static constexpr bool startGuardsAgree(const RoleTransition* t, uint8_t i, uint8_t guard) {
+  return i == STATUS_COUNT * 2 ||
+         ((t[i].action != ActStart || t[i].guard == guard) && startGuardsAgree(t, i + 1, guard));
+}
+
+template <uint8_t Role>
+constexpr uint8_t reportedStatus(uint8_t action) {
+  return action == ActStart ? RolePolicy<Role>::kStartStatus
+       : action == ActComplete ? RolePolicy<Role>::kCompleteStatus
+       : action == ActStop ? RolePolicy<Role>::kStopStatus
+       : 0xFF;
+}
+
+// No role reacts to a status it reports itself, which would loop forever
+template <uint8_t Role>
+constexpr bool noSelfTrigger(uint8_t i) {
+  return i == STATUS_COUNT * 2 ||
+         (reportedStatus<Role>(RolePolicy<Role>::transitions()[i].action) !=
+              RolePolicy<Role>::transitions()[i].status &&
+          noSelfTrigger<Role>(i + 1));
+}
+
+template <uint8_t Role>
+constexpr bool tableValid() {
+  return rowsInOrder(RolePolicy<Role>::transitions(), 0) &&
+         guardsMatch(RolePolicy<Role>::transitions(), 0) &&
+         startsOnlyWhenIdle(RolePolicy<Role>::transitions(), 0) &&
+         startTrigger(RolePolicy<Role>::transitions(), 0) < STATUS_COUNT &&
+         startGuardsAgree(RolePolicy<Role>::transitions(), 0,
+                          RolePolicy<Role>::transitions()[startTrigger(RolePolicy<Role>::transitions(), 0) * 2].guard) &&
+         noSelfTrigger<Role>(0);
+}
+
+static_assert(sizeof(MASTER_TRANSITIONS) / sizeof(RoleTransition) == STATUS_COUNT * 2, "MASTER table incomplete");
+static_assert(sizeof(SLAVE1_TRANSITIONS) / sizeof(RoleTransition) == STATUS_COUNT * 2, "SLAVE1 table incomplete");
+static_assert(sizeof(SLAVE2_TRANSITIONS) / sizeof(RoleTransition) == STATUS_COUNT * 2, "SLAVE2 table incomplete");
+static_assert(tableValid<ROLE_MASTER>(), "MASTER transition table out of order or inconsistent");
+static_assert(tableValid<ROLE_SLAVE1>(), "SLAVE1 transition table out of order or inconsistent");
+static_assert(tableValid<ROLE_SLAVE2>(), "SLAVE2 transition table out of order or inconsistent");
+
+// Every status a board reports belongs to exactly one role, so the server
+// (and the other boards) can always tell who moved the irrigation along
+static constexpr uint16_t statusBits(uint8_t a, uint8_t b, uint8_t c) {
+  return (uint16_t)((1U << a) | (1U << b) | (1U << c));
+}
+static_assert((statusBits(RolePolicy<ROLE_MASTER>::kStartStatus, RolePolicy<ROLE_MASTER>::kCompleteStatus,
+                          RolePolicy<ROLE_MASTER>::kStopStatus) &
+               statusBits(RolePolicy<ROLE_SLAVE1>::kStartStatus, RolePolicy<ROLE_SLAVE1>::kCompleteStatus,
+                          RolePolicy<ROLE_SLAVE1>::kStopStatus)) == 0 &&
+              (statusBits(RolePolicy<ROLE_MASTER>::kStartStatus, RolePolicy<ROLE_MASTER>::kCompleteStatus,
+                          RolePolicy<ROLE_MASTER>::kStopStatus) &
+               statusBits(RolePolicy<ROLE_SLAVE2>::kStartStatus, RolePolicy<ROLE_SLAVE2>::kCompleteStatus,
+                          RolePolicy<ROLE_SLAVE2>::kStopStatus)) == 0 &&
+              (statusBits(RolePolicy<ROLE_SLAVE1>::kStartStatus, RolePolicy<ROLE_SLAVE1>::kCompleteStatus,
+                          RolePolicy<ROLE_SLAVE1>::kStopStatus) &
+               statusBits(RolePolicy<ROLE_SLAVE2>::kStartStatus, RolePolicy<ROLE_SLAVE2>::kCompleteStatus,
+                          RolePolicy<ROLE_SLAVE2>::kStopStatus)) == 0,
+              "two roles report the same status");
+
+typedef RolePolicy<ROLE> ThisRole;
+// Server status whose idle row startLocalProgram() follows
+static constexpr uint8_t LOCAL_START_TRIGGER = startTrigger(ThisRole::transitions(), 0);
+
+#endif
@@ -0,0 +1,275 @@
+#include "Schedule.h"
+#include "Sim900.h"
+#include "Irrigation.h"
+#include "EepromStore.h"
+
+#define LOG(x) Serial.print(x)
+#define LOGln(x) Serial.println(x)
+
+namespace {
+  // 0 = Sunday (Sakamoto's method)
+  uint8_t dayOfWeek(uint16_t y, uint8_t m, uint8_t d) {
+    static const uint8_t t[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    if (m < 3) y -= 1;
+    return (uint8_t)((y + y / 4 - y / 100 + y / 400 + t[m - 1] + d) % 7);
+  }
+
+  // minutes from a to b going forward around the week
+  uint16_t forwardMinutes(uint16_t a, uint16_t b) {
+    return (uint16_t)((b + MINUTES_PER_WEEK - a) % MINUTES_PER_WEEK);
+  }
+
+  int twoDigits(const String& s, int at) {
+    if (at + 1 >= (int)s.length()) return -1;
+    char a = s[at], b = s[at + 1];
+    if (a < '0' || a > '9' || b < '0' || b > '9') return -1;
+    return (a - '0') * 10 + (b - '0');
+  }
+}
+
+// --- WallClock ---
+
+WallClock::WallClock()
+  : isSet(false),
+    secOfWeekAtAnchor(0),
+    anchorMs(0) {
+}
+
+bool WallClock::parse(const String& s) {
+  // Skip an opening quote if present (AT+CCLK wraps the value in quotes)
+  int i = (s.length() > 0 && s[0] == '"') ? 1 : 0;
+  int yy = twoDigits(s, i);
+  int mo = twoDigits(s, i + 3);
+  int dd = twoDigits(s, i + 6);
+  int hh = twoDigits(s, i + 9);
+  int mi = twoDigits(s, i + 12);
+  int ss = twoDigits(s, i + 15);
+  if (yy < 0 || mo < 1 || mo > 12 || dd < 1 || dd > 31 || hh < 0 || hh > 23 ||
+      mi < 0 || mi > 59 || ss < 0 || ss > 59) {
+    return false;
+  }
+  // The SIM900 RTC starts at 2004 until the network or we set it
+  if (yy < CLOCK_MIN_VALID_YEAR) return false;
+  uint8_t dow = dayOfWeek((uint16_t)(2000 + yy), (uint8_t)mo, (uint8_t)dd);
+  secOfWeekAtAnchor = (uint32_t)dow * 86400UL + (uint32_t)hh * 3600UL + (uint32_t)mi * 60UL + (uint32_t)ss;
+  anchorMs = millis();
+  isSet = true;
+  return true;
+}
+
+uint16_t WallClock::minuteOfWeek(uint32_t now) const {
+  uint32_t sec = secOfWeekAtAnchor + (now - anchorMs) / 1000UL;
+  return (uint16_t)((sec / 60UL) % MINUTES_PER_WEEK);
+}
+
+uint32_t WallClock::msToNextMinute(uint32_t now) const {
+  uint32_t ms = (secOfWeekAtAnchor % 60UL) * 1000UL + (now - anchorMs);
+  return 60000UL - (ms % 60000UL);
+}
+
+// --- ScheduleEngine ---
+
+ScheduleEngine::ScheduleEngine(IrrigationManager& irr, Sim900Client& modem)
+  : irrigation(irr),
+    sim(modem),
+    clock(),
+    schedule(),
+    haveLastMinute(false),
+    lastMinute(0),
+    lastFetchMs(0),
+    lastClockSyncMs(0),
+    fetchRequested(false),
+    clockRequested(false),
+    fetchedOnce(false) {
+}
+
+void ScheduleEngine::begin() {
+  if (EepromStore::loadSchedule(schedule)) {
+    LOG("Schedule loaded: "); LOG(schedule.count); LOG(" programs, V="); LOGln(schedule.serverVersion);
+  } else {
+    schedule = StoredSchedule();
+  }
+}
+
+void ScheduleEngine::tick() {
+  uint32_t now = millis();
+
+  // Results handed over by the modem
+  String body;
+  if (sim.takeScheduleBody(body)) onDownload(body);
+  String clk;
+  if (sim.takeClockReading(clk) && clock.parse(clk)) {
+    LOG("Clock synced: "); LOGln(clk);
+  }
+
+  // Requests for the modem; it serves them when idle. Until a download is
+  // accepted and the clock reads valid they are retried at the short period.
+  if (!fetchRequested || now - lastFetchMs >= fetchPeriod()) {
+    if (sim.requestScheduleFetch()) {
+      fetchRequested = true;
+      lastFetchMs = now;
+    }
+  }
+  uint32_t syncPeriod = clock.valid() ? CLOCK_SYNC_INTERVAL_MS : CLOCK_RETRY_MS;
+  if (!clockRequested || now - lastClockSyncMs >= syncPeriod) {
+    if (sim.requestClockSync()) {
+      clockRequested = true;
+      lastClockSyncMs = now;
+    }
+  }
+
+  if (!clock.valid() || schedule.count == 0) return;
+  uint16_t minute = clock.minuteOfWeek(now);
+  if (!haveLastMinute) {
+    // Let a program due this very minute still start after boot
+    lastMinute = (uint16_t)((minute + MINUTES_PER_WEEK - 1) % MINUTES_PER_WEEK);
+    haveLastMinute = true;
+  }
+  if (minute == lastMinute) return;
+  // A clock resync that jumps far ahead must not replay missed programs
+  if (forwardMinutes(lastMinute, minute) <= SCHEDULE_MAX_CATCHUP_MIN) {
+    fireDue(lastMinute, minute);
+  }
+  lastMinute = minute;
+}
+
+void ScheduleEngine::fireDue(uint16_t fromMinute, uint16_t toMinute) {
+  uint16_t span = forwardMinutes(fromMinute, toMinute);
+  for (uint8_t i = 0; i < schedule.count; i++) {
+    const ScheduledProgram& p = schedule.programs[i];
+    for (uint8_t d = 0; d < 7; d++) {
+      if (!(p.days & (1 << d))) continue;
+      uint16_t at = (uint16_t)(d * 1440U + p.startMinute);
+      uint16_t dist = forwardMinutes(fromMinute, at);
+      if (dist > 0 && dist <= span) start(p);
+    }
+  }
+}
+
+uint32_t ScheduleEngine::msUntilNextStart(uint32_t now) const {
+  if (!clock.valid() || schedule.count == 0) return 0xFFFFFFFFUL;
+  uint16_t minute = clock.minuteOfWeek(now);
+  uint16_t best = MINUTES_PER_WEEK;
+  for (uint8_t i = 0; i < schedule.count; i++) {
+    const ScheduledProgram& p = schedule.programs[i];
+    for (uint8_t d = 0; d < 7; d++) {
+      if (!(p.days & (1 << d))) continue;
+      uint16_t dist = forwardMinutes(minute, (uint16_t)(d * 1440U + p.startMinute));
+      if (dist > 0 && dist < best) best = dist;
+    }
+  }
+  if (best == MINUTES_PER_WEEK) return 0xFFFFFFFFUL;
+  return (uint32_t)(best - 1) * 60000UL + clock.msToNextMinute(now);
+}
+
+static uint32_t remainingMs(uint32_t elapsed, uint32_t period) {
+  return elapsed >= period ? 0 : period - elapsed;
+}
+
+// Short period while no download was accepted yet or the poll announces a
+// different V=, the regular refresh otherwise
+uint32_t ScheduleEngine::fetchPeriod() const {
+  if (!fetchedOnce) return SCHEDULE_RETRY_MS;
+  long serverVersion = sim.serverScheduleVersion();
+  if (serverVersion >= 0 && (uint16_t)serverVersion != schedule.serverVersion) return SCHEDULE_RETRY_MS;
+  return SCHEDULE_REFRESH_MS;
+}
+
+uint32_t ScheduleEngine::msUntilNextWork(uint32_t now) const {
+  if (!fetchRequested || !clockRequested) return 0;
+  uint32_t wait = remainingMs(now - lastFetchMs, fetchPeriod());
+  uint32_t sync = remainingMs(now - lastClockSyncMs, clock.valid() ? CLOCK_SYNC_INTERVAL_MS : CLOCK_RETRY_MS);
+  if (sync < wait) wait = sync;
+  // Programs are checked once per minute of the local clock
+  if (clock.valid() && schedule.count > 0) {
+    uint32_t minute = clock.msToNextMinute(now);
+    if (minute < wait) wait = minute;
+  }
+  return wait;
+}
+
+void ScheduleEngine::start(const ScheduledProgram& p) {
+  IrrigationCommand cmd;
+  cmd.id = LOCAL_RUN_ID_BASE + p.id;
+  for (uint8_t z = 1; z <= ZONES_MAX; z++) {
+    if (p.zoneMask & (1U << (z - 1))) cmd.zones[cmd.numZones++] = z;
+  }
+  cmd.totalMinutes = p.durationMin;
+  cmd.remainingMinutes = p.durationMin;
+  cmd.valid = true;
+  LOG("Schedule: program "); LOG(p.id);
+  if (irrigation.startLocalProgram(cmd)) LOGln(" started");
+  else LOGln(" skipped (busy or no zones for this role)");
+}
+
+bool ScheduleEngine::parseProgram(const String& line, ScheduledProgram& out) const {
+  String pStr = ParserServer::readField(line, "P");
+  String dStr = ParserServer::readField(line, "D");
+  String hStr = ParserServer::readField(line, "H");
+  String lStr = ParserServer::readField(line, "L");
+  String zStr = ParserServer::readField(line, "Z");
+  if (pStr.length() == 0 || hStr.length() < 5) return false;
+  int hh = twoDigits(hStr, 0);
+  int mi = twoDigits(hStr, 3);
+  if (hh < 0 || hh > 23 || mi < 0 || mi > 59) return false;
+
+  out.id = (uint16_t)pStr.toInt();
+  out.days = (uint8_t)(dStr.toInt() & 0x7F);
+  out.durationMin = (uint8_t)lStr.toInt();
+  out.startMinute = (uint16_t)(hh * 60 + mi);
+  out.zoneMask = 0;
+  int start = 0;
+  while (start < (int)zStr.length()) {
+    int comma = zStr.indexOf(',', start);
+    int z = (comma >= 0 ? zStr.substring(start, comma) : zStr.substring(start)).toInt();
+    if (z >= 1 && z <= ZONES_MAX) out.zoneMask |= (uint16_t)(1U << (z - 1));
+    if (comma < 0) break;
+    start = comma + 1;
+  }
+  return out.durationMin > 0 && out.days != 0 && out.zoneMask != 0;
+}
+
+// Body: one item per line
+//   V=<schedule version>
+//   NOW=yy/MM/dd,hh:mm:ss           (server local time)
+//   P=<id>;D=<day mask>;H=HH:MM;L=<minutes>;Z=<zones>
+void ScheduleEngine::onDownload(const String& body) {
+  StoredSchedule next = StoredSchedule();
+  bool sawVersion = false;
+  int start = 0;
+  while (start < (int)body.length()) {
+    int nl = body.indexOf('\n', start);
+    String line = (nl >= 0) ? body.substring(start, nl) : body.substring(start);
+    line.trim();
+    if (line.startsWith("V=")) {
+      next.serverVersion = (uint16_t)line.substring(2).toInt();
+      sawVersion = true;
+    } else if (line.startsWith("NOW=")) {
+      clock.parse(line.substring(4));
+    } else if (line.startsWith("P=")) {
+      if (next.count < SCHEDULE_MAX_PROGRAMS) {
+        if (parseProgram(line, next.programs[next.count])) next.count++;
+      } else {
+        LOG("Schedule warning: too many programs, ignoring "); LOGln(line);
+      }
+    }
+    if (nl < 0) break;
+    start = nl + 1;
+  }
+  // Without V= the body is not a schedule (error page, empty reply)
+  if (!sawVersion) {
+    LOGln("Schedule download rejected");
+    return;
+  }
+  fetchedOnce = true;
+  if (next.serverVersion == schedule.serverVersion && next.count == schedule.count) {
+    bool same = true;
+    for (uint8_t i = 0; i < next.count && same; i++) {
+      same = memcmp(&next.programs[i], &schedule.programs[i], sizeof(ScheduledProgram)) == 0;
+    }
+    if (same) return; // avoid needless EEPROM writes
+  }
+  schedule = next;
+  EepromStore::saveSchedule(schedule);
+  LOG("Schedule updated: "); LOG(schedule.count); LOG(" programs, V="); LOGln(schedule.serverVersion);
+}
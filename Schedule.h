@@ -0,0 +1,80 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+class Sim900Client;
+class IrrigationManager;
+
+static const uint16_t MINUTES_PER_WEEK = 7U * 24U * 60U;
+
+// One weekly program as stored in EEPROM (8 bytes)
+struct ScheduledProgram {
+  uint16_t id;          // server program id; reports use LOCAL_RUN_ID_BASE + id
+  uint8_t days;         // bit0 = Sunday .. bit6 = Saturday
+  uint8_t durationMin;
+  uint16_t startMinute; // minute of day, 0..1439
+  uint16_t zoneMask;    // bit z-1 = zone z
+};
+
+struct StoredSchedule {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t count;
+  uint16_t serverVersion; // V= of the downloaded schedule
+  ScheduledProgram programs[SCHEDULE_MAX_PROGRAMS];
+  uint16_t checksum;
+};
+
+// Local wall-clock time anchored to millis(), set from AT+CCLK or the
+// NOW= line of a schedule download.
+class WallClock {
+public:
+  WallClock();
+  bool valid() const { return isSet; }
+  bool parse(const String& s); // "yy/MM/dd,hh:mm:ss[+zz]"
+  uint16_t minuteOfWeek(uint32_t now) const;
+  uint32_t msToNextMinute(uint32_t now) const;
+
+private:
+  bool isSet;
+  uint32_t secOfWeekAtAnchor;
+  uint32_t anchorMs;
+};
+
+// Runs downloaded weekly programs from the local clock so irrigation keeps
+// happening when the GPRS link is down. The server is contacted only to
+// refresh the schedule (when the poll reports a new V= or every
+// SCHEDULE_REFRESH_MS) and to receive status reports.
+class ScheduleEngine {
+public:
+  ScheduleEngine(IrrigationManager& irrigation, Sim900Client& modem);
+
+  void begin(); // load the stored schedule from EEPROM
+  void tick();
+  uint32_t msUntilNextStart(uint32_t now) const; // 0xFFFFFFFF when nothing is scheduled
+  uint32_t msUntilNextWork(uint32_t now) const;  // next minute check, refresh or clock sync
+
+private:
+  void onDownload(const String& body);
+  bool parseProgram(const String& line, ScheduledProgram& out) const;
+  void fireDue(uint16_t fromMinute, uint16_t toMinute);
+  void start(const ScheduledProgram& p);
+
+  IrrigationManager& irrigation;
+  Sim900Client& sim;
+  WallClock clock;
+  StoredSchedule schedule;
+  bool haveLastMinute;
+  uint16_t lastMinute;       // last minute of week already checked
+  uint32_t fetchPeriod() const;
+
+  uint32_t lastFetchMs;      // last schedule request
+  uint32_t lastClockSyncMs;  // last clock request
+  bool fetchRequested;
+  bool clockRequested;
+  bool fetchedOnce;          // a schedule body was accepted since boot
+};
+
+#endif
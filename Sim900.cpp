@@ -2,21 +2,89 @@
 #include "Irrigation.h"
 #include "Pins.h"
 
+namespace {
+  uint32_t commandHash(const IrrigationCommand& c) {
+    uint8_t fields[4 + ZONES_MAX + 5];
+    uint8_t n = 0;
+    for (uint8_t b = 0; b < 4; b++) fields[n++] = (uint8_t)((uint32_t)c.id >> (8 * b));
+    for (uint8_t i = 0; i < c.numZones; i++) fields[n++] = c.zones[i];
+    fields[n++] = c.totalMinutes;
+    fields[n++] = c.remainingMinutes;
+    fields[n++] = c.status;
+    fields[n++] = (uint8_t)c.targetLiters;
+    fields[n++] = (uint8_t)(c.targetLiters >> 8);
+    uint32_t h = 2166136261UL;
+    for (uint8_t i = 0; i < n; i++) {
+      h ^= fields[i];
+      h *= 16777619UL;
+    }
+    return h;
+  }
+
+  void printCommand(const IrrigationCommand& cmd) {
+    Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Got: ");
+    Serial.print("ID="); Serial.print(cmd.id);
+    Serial.print(" T="); Serial.print(cmd.totalMinutes);
+    Serial.print(" M="); Serial.print(cmd.remainingMinutes);
+    Serial.print(" S="); Serial.print(cmd.status);
+    if (cmd.targetLiters > 0) { Serial.print(" L="); Serial.print(cmd.targetLiters); }
+
+    Serial.print("; Zones["); Serial.print(cmd.numZones); Serial.print("]:");
+    for (uint8_t i = 0; i < cmd.numZones; i++) {
+      uint8_t z = cmd.zones[i];
+      int pin = getZonePin(z);
+      Serial.print("Z"); Serial.print(z);
+      Serial.print("->P"); Serial.print(pin); Serial.print("; ");
+    }
+    Serial.println();
+  }
+}
+
 Sim900Client::Sim900Client()
   : sim(NULL),
     state(Idle),
+    resumeState(Idle),
     stateSince(0),
     stateTimeout(0),
     newResponse(false),
-    nextPollAt(0) {
+    poller(),
+    inFlight(ReqNone),
+    scheduleReady(false),
+    clockReady(false),
+    scheduleVersion(-1),
+    urcLineStart(0),
+    hangupPending(false),
+    smsTextNext(false),
+    smsToRead(-1),
+    statWakes(0),
+    compactSkip(0),
+    compactPenalty(1),
+    hasBodyHash(false),
+    lastBodyHash(0),
+    batchCount(0),
+    batchNext(0),
+    appliedCount(0),
+    appliedNext(0),
+    statPolls(0),
+    statUnchanged(0),
+    statBodyBytes(0),
+    statStaleRecords(0),
+    resetReportInFlight(false),
+    pollBlocked(false),
+    pollBlockedSince(0) {
 }
 
 void Sim900Client::begin(Stream& serialRef) {
   sim = &serialRef;
+  if (MODEM_DTR_PIN >= 0) {
+    pinMode(MODEM_DTR_PIN, OUTPUT);
+    digitalWrite(MODEM_DTR_PIN, LOW); // awake
+  }
   state = Idle;
   stateSince = millis();
-  // Kick off bearer setup immediately on init
-  changeState(StartBearer0, "init");
+  // Kick off URC and bearer setup immediately on init; caller id and SMS
+  // notifications are only wanted when someone may push a wake-up
+  changeState(PUSH_WAKE_ENABLED ? SetClip : SetSlowClock, "init");
 }
 
 bool Sim900Client::isIdle() const {
@@ -24,6 +92,11 @@ bool Sim900Client::isIdle() const {
 }
 
 void Sim900Client::changeState(State s, const char* reason) {
+  // Leaving Idle with the modem in slow-clock mode: raise it through DTR first
+  if (MODEM_DTR_PIN >= 0 && state == Idle && s != Idle && s != WakeModem) {
+    resumeState = s;
+    s = WakeModem;
+  }
   State prev = state;
   state = s;
   stateSince = millis();
@@ -62,6 +135,15 @@ void Sim900Client::readIntoBuffer() {
     new_data = true;
     char c = (char)sim->read();
     buffer += c;
+    // Unsolicited result codes can show up in any state, including in the
+    // middle of an HTTP transaction, so lines are scanned as they stream in
+    if (c == '\n') {
+      onLine(urcLine);
+      urcLine = "";
+      urcLineStart = buffer.length();
+    } else if (c != '\r' && urcLine.length() < 96) {
+      urcLine += c;
+    }
     delay(1);
   }
   if (new_data) {
@@ -70,10 +152,68 @@ void Sim900Client::readIntoBuffer() {
   }
 }
 
+// Caller number is the first quoted field after the colon for +CLIP and
+// +CMT, and the second one for +CMGR
+bool Sim900Client::senderAllowed(const String& line) const {
+  int q = line.indexOf('"');
+  if (line.startsWith("+CMGR:")) q = line.indexOf('"', line.indexOf('"', q + 1) + 1);
+  if (q < 0) return false;
+  int e = line.indexOf('"', q + 1);
+  if (e < 0) return false;
+  String number = line.substring(q + 1, e);
+  if (number.length() == 0) return false;
+  String allowed = String(",") + PUSH_WAKE_NUMBERS + ",";
+  return allowed.indexOf(String(",") + number + ",") >= 0;
+}
+
+// A call or SMS can arrive whether or not push wake-up is configured, so
+// URCs are always stripped and calls always hung up; only the wake-up
+// itself depends on PUSH_WAKE_NUMBERS
+void Sim900Client::onLine(const String& line) {
+  bool urc = false;
+  if (smsTextNext) {
+    urc = true; // the text line that follows a +CMT header
+    smsTextNext = false;
+  } else if (line.startsWith("RING")) {
+    urc = true; // the caller id follows in +CLIP if enabled
+    hangupPending = true;
+  } else if (line.startsWith("+CLIP:")) {
+    urc = true;
+    hangupPending = true;
+    if (senderAllowed(line)) {
+      statWakes++;
+      poller.requestImmediate();
+    }
+  } else if (line.startsWith("+CMT:")) {
+    urc = true;
+    smsTextNext = true;
+    if (senderAllowed(line)) {
+      statWakes++;
+      poller.requestImmediate();
+    }
+  } else if (line.startsWith("+CMTI:")) {
+    // SMS went to storage: read the sender later, when the modem is free
+    urc = true;
+    int comma = line.lastIndexOf(',');
+    if (comma >= 0) smsToRead = line.substring(comma + 1).toInt();
+  } else if (state == SmsRead && line.startsWith("+CMGR:")) {
+    if (senderAllowed(line)) {
+      statWakes++;
+      poller.requestImmediate();
+    }
+  }
+  if (urc) {
+    // Keep URCs out of command responses; an HTTPREAD body counts bytes.
+    // The line just ended, so it is the tail of the buffer.
+    buffer.remove(urcLineStart);
+  }
+}
+
 void Sim900Client::clearBuffer() {
   //Serial.print("Clearing buffer: ");
   //Serial.println(buffer);
   buffer = "";
+  urcLineStart = 0;
 }
 
 bool Sim900Client::startGet(const char* url) {
@@ -86,6 +226,39 @@ bool Sim900Client::startGet(const char* url) {
   return true;
 }
 
+bool Sim900Client::requestScheduleFetch() {
+  if (modemJobs.has(JobSchedule) || inFlight == ReqSchedule) return false;
+  ModemJob job = ModemJob();
+  job.kind = JobSchedule;
+  job.priority = PrioBackground;
+  job.enqueuedAt = millis();
+  return modemJobs.push(job);
+}
+
+bool Sim900Client::requestClockSync() {
+  if (modemJobs.has(JobClock) || state == ClockQuery) return false;
+  ModemJob job = ModemJob();
+  job.kind = JobClock;
+  job.priority = PrioBackground;
+  job.enqueuedAt = millis();
+  return modemJobs.push(job);
+}
+
+bool Sim900Client::takeScheduleBody(String& out) {
+  if (!scheduleReady) return false;
+  scheduleReady = false;
+  out = scheduleBody;
+  scheduleBody = "";
+  return true;
+}
+
+bool Sim900Client::takeClockReading(String& out) {
+  if (!clockReady) return false;
+  clockReady = false;
+  out = clockReading;
+  return true;
+}
+
 bool Sim900Client::hasNewResponse() const {
   return newResponse;
 }
@@ -125,6 +298,17 @@ void Sim900Client::loop() {
       }
       // Not enough data yet; keep waiting
     } else {
+      if (state == ClockQuery) {
+        // +CCLK: "yy/MM/dd,hh:mm:ss+zz"
+        int idx = buffer.indexOf("+CCLK:");
+        if (idx >= 0) {
+          int q = buffer.indexOf('"', idx);
+          if (q >= 0) {
+            clockReading = buffer.substring(q + 1);
+            clockReady = true;
+          }
+        }
+      }
       changeState(def.onComplete, "complete");
       return;
     }
@@ -137,71 +321,232 @@ void Sim900Client::loop() {
     // Serial.println("FROM state: ");
     // Serial.println(state);
     // delay(1000);
-    changeState(def.onTimeout, "timeout");
+    changeState(state == WakeModem ? resumeState : def.onTimeout, "timeout");
     return;
   }
 }
 
+int Sim900Client::runJob(const ModemJob& job, uint32_t now) {
+  if (job.kind == JobStatus || job.kind == JobMinute) {
+    String url = ParserServer::buildStatusUrl(job.id, job.status, job.minutes,
+                                               job.liters, job.fault);
+    if (url.length() == 0) return -2;
+    // Tell the server once why this board last restarted
+    uint8_t cause, subsystem;
+    resetReportInFlight = watchdog.pendingReport(cause, subsystem);
+    if (resetReportInFlight) {
+      url += "&r="; url += cause;
+      url += "&b="; url += subsystem;
+    }
+    Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Sending queued status: ");
+    Serial.println(url);
+    startGet(url.c_str());
+    inFlight = ReqStatus;
+    // status updates do not affect regular polling interval
+    return -3;
+  }
+  if (job.kind == JobSchedule) {
+    Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Fetching schedule: ");
+    Serial.println(ROLE_SCHEDULE_URL);
+    startGet(ROLE_SCHEDULE_URL);
+    inFlight = ReqSchedule;
+    return -2;
+  }
+  if (job.kind == JobClock) {
+    changeState(ClockQuery, "clock");
+    return -2;
+  }
+  // JobPoll. Conditional poll: the server answers with an empty body if its
+  // command still hashes to h
+  String pollUrl = ROLE_URL;
+  if (hasBodyHash) {
+    pollUrl += "&h=";
+    pollUrl += String(lastBodyHash, HEX);
+  }
+  if (COMPACT_PAYLOAD) {
+    if (compactSkip == 0) pollUrl += "&f=b";
+    else compactSkip--;
+  }
+  Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Polling: "); Serial.print(pollUrl);
+  Serial.print("  next in "); Serial.print(poller.interval() / 1000); Serial.print("s");
+  startGet(pollUrl.c_str());
+  inFlight = ReqPoll;
+  poller.onPollStarted(now);
+  statPolls++;
+  Serial.print("  State: ");
+  Serial.print(defFor(state).name);
+  Serial.println();
+  return -2;
+}
+
+uint32_t Sim900Client::msUntilNextWork(uint32_t now) const {
+  if (!isIdle()) {
+    // Mid-transaction: nothing to do before the reply (which wakes the
+    // MCU through the UART) or the state timeout
+    if (stateTimeout == 0) return 0;
+    uint32_t elapsed = now - stateSince;
+    return elapsed >= stateTimeout ? 0 : stateTimeout - elapsed;
+  }
+  if (hasNewResponse() || modemJobs.size() > 0 || hangupPending || smsToRead >= 0) return 0;
+  return poller.msUntilDue(now);
+}
+
+void Sim900Client::printStats(Print& out) const {
+  out.print("["); out.print(ROLE_NAME); out.print("] polls="); out.print(statPolls);
+  out.print(" unchanged="); out.print(statUnchanged);
+  out.print(" bodyBytes="); out.print(statBodyBytes);
+  out.print(" staleRecords="); out.print(statStaleRecords);
+  out.print(" wakes="); out.println(statWakes);
+  modemJobs.printStats(out);
+}
+
 int Sim900Client::pollAndProcess(IrrigationCommand& cmd) {
   unsigned long now = millis();
-  // If there is a queued status update and modem is idle, send it immediately
+  // A due poll starts in the first pass that finds the modem idle, so one
+  // that keeps not starting on an idle modem means the queue is wedged.
+  // A busy modem (bearer retries, a slow network) is not a stall.
+  if (isIdle() && poller.due(now)) {
+    if (!pollBlocked) pollBlockedSince = now;
+    pollBlocked = true;
+  } else {
+    pollBlocked = false;
+  }
+  if (!pollBlocked || now - pollBlockedSince < WATCHDOG_POLL_STALL_MS) watchdog.checkIn(SubPoller);
+  // A local transition means the same server body may now call for a
+  // different action, so it must be evaluated again
+  if (ParserServer::consumeStatusChanged()) {
+    hasBodyHash = false;
+    appliedCount = 0;
+  }
+  // Finish the records of the last body first, so the status updates they
+  // cause queue up together ahead of the next poll
+  if (nextBatchCommand(cmd)) return 0;
   if (isIdle() && !hasNewResponse()) {
-    String pendingUrl;
-    if (ParserServer::consumePendingStatus(pendingUrl) && pendingUrl.length() > 0) {
-      Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Sending queued status: ");
-      Serial.println(pendingUrl);
-      startGet(pendingUrl.c_str());
-      // status updates do not affect regular polling interval
-      return -3;
+    // URC follow-ups are short and keep the modem usable, do them first
+    if (hangupPending) {
+      hangupPending = false;
+      changeState(Hangup, "missed call");
+      return -2;
     }
+    if (smsToRead >= 0) {
+      changeState(SmsRead, "sms");
+      return -2;
+    }
+    // A due poll joins the queue with a deadline, so higher-priority
+    // status traffic can delay it by at most POLL_MAX_DELAY_MS
+    if (poller.due(now) && !modemJobs.has(JobPoll)) {
+      ModemJob job = ModemJob();
+      job.kind = JobPoll;
+      job.priority = PrioNormal;
+      job.enqueuedAt = now;
+      job.deadline = now + POLL_MAX_DELAY_MS;
+      job.hasDeadline = true;
+      modemJobs.push(job);
+    }
+    ModemJob job;
+    if (modemJobs.pop(now, job)) return runJob(job, now);
   }
-  if (now >= nextPollAt) {
-    Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Polling: "); Serial.print(ROLE_URL);
-    if (isIdle() && !hasNewResponse()) startGet(ROLE_URL);
-    else Serial.print("  --> [skipped, modem busy].");
-    Serial.print("  State: ");
-    Serial.print(defFor(state).name);
-    Serial.println();
-
-    nextPollAt = now + POLL_INTERVAL_MS;
-  }
-  
 
   if (hasNewResponse()) {
     String body = takeResponse();
+    bool wasPoll = inFlight == ReqPoll;
+    if (inFlight == ReqSchedule) {
+      inFlight = ReqNone;
+      scheduleBody = body;
+      scheduleReady = true;
+      return -2;
+    }
+    if (inFlight == ReqStatus) {
+      // The server's acknowledgement, not a command
+      inFlight = ReqNone;
+      if (resetReportInFlight) {
+        resetReportInFlight = false;
+        watchdog.reportSent();
+      }
+      return -3;
+    }
+    inFlight = ReqNone;
+    if (wasPoll) {
+      statBodyBytes += body.length();
+      uint32_t h = ParserServer::bodyHash(body);
+      if (hasBodyHash && (body.length() == 0 || h == lastBodyHash)) {
+        // Nothing new: skip parsing and command handling entirely
+        statUnchanged++;
+        poller.onPollResult(false);
+        return -4;
+      }
+      poller.onPollResult(true);
+      hasBodyHash = true;
+      lastBodyHash = h;
+      // Optional V=<n> (or a version-2 compact record) announces the
+      // current weekly schedule version
+      long v = ParserServer::announcedScheduleVersion(body);
+      if (v >= 0) scheduleVersion = v;
+    }
     Serial.print("[");
     Serial.print(ROLE_NAME);
     Serial.print("] HTTP body: ");
-    Serial.print(body);
-
-    cmd = ParserServer::parsePayload(body);
-    if (!cmd.valid) {
+    Serial.println(body);
+
+    bool corruptCompact = false;
+    batchCount = ParserServer::parseBatch(body, batch, POLL_MAX_RECORDS, corruptCompact);
+    batchNext = 0;
+    if (wasPoll && corruptCompact) {
+      // Corrupt compact record: re-poll in text right away and keep to text
+      // for a number of polls that doubles with every failure in a row
+      compactSkip = compactPenalty;
+      if (compactPenalty < COMPACT_MAX_TEXT_POLLS) compactPenalty = (uint8_t)(compactPenalty * 2);
+      hasBodyHash = false;
+      poller.requestImmediate();
+    } else if (wasPoll && ParserServer::isCompactPayload(body)) {
+      compactPenalty = 1;
+    }
+    if (batchCount == 0) {
       Serial.println("Parse failed or empty command.");
       return -1;
     }
+    if (nextBatchCommand(cmd)) return 0;
+    return -4; // every record was applied already
+  }
+  return -2;
+}
 
-    Serial.print("; Got: ");
-    Serial.print("ID="); Serial.print(cmd.id);
-    Serial.print(" T="); Serial.print(cmd.totalMinutes);
-    Serial.print(" M="); Serial.print(cmd.remainingMinutes);
-    Serial.print(" S="); Serial.print(cmd.status);
+// Returns false if this exact record was the last one applied for its id
+bool Sim900Client::markApplied(const IrrigationCommand& c) {
+  uint32_t h = commandHash(c);
+  for (uint8_t i = 0; i < appliedCount; i++) {
+    if (applied[i].id != c.id) continue;
+    if (applied[i].hash == h) return false;
+    applied[i].hash = h;
+    return true;
+  }
+  applied[appliedNext].id = c.id;
+  applied[appliedNext].hash = h;
+  appliedNext = (uint8_t)((appliedNext + 1) % POLL_MAX_RECORDS);
+  if (appliedCount < POLL_MAX_RECORDS) appliedCount++;
+  return true;
+}
 
-    Serial.print("; Zones["); Serial.print(cmd.numZones); Serial.print("]:");
-    for (uint8_t i = 0; i < cmd.numZones; i++) {
-      uint8_t z = cmd.zones[i];
-      int pin = getZonePin(z);
-      Serial.print("Z"); Serial.print(z);
-      Serial.print("->P"); Serial.print(pin); Serial.print("; ");
+bool Sim900Client::nextBatchCommand(IrrigationCommand& cmd) {
+  while (batchNext < batchCount) {
+    const IrrigationCommand& c = batch[batchNext++];
+    if (!markApplied(c)) {
+      statStaleRecords++;
+      continue;
     }
-    Serial.println();
-
-    return 0; 
+    printCommand(c);
+    cmd = c;
+    return true;
   }
-  return -2;
+  return false;
 }
 
 // --- State table and entry actions ---
-void Sim900Client::enter_NoOp() {/* nothing */}
+void Sim900Client::enter_Idle() {
+  // Let the modem drop into slow-clock mode until the next transaction
+  if (MODEM_DTR_PIN >= 0) digitalWrite(MODEM_DTR_PIN, HIGH);
+}
+void Sim900Client::enter_WakeModem() { digitalWrite(MODEM_DTR_PIN, LOW); }
 void Sim900Client::enter_Error() {}
 void Sim900Client::enter_StartBearer0() { sendCmd("AT+SAPBR=0,1"); }
 void Sim900Client::enter_SetContype() { sendCmd("AT+SAPBR=3,1,\"Contype\",\"GPRS\""); }
@@ -213,6 +558,18 @@ void Sim900Client::enter_HttpCid() { sendCmd("AT+HTTPPARA=\"CID\",1"); }
 void Sim900Client::enter_HttpUrl() { sendCmd(String("AT+HTTPPARA=\"URL\",\"") + currentUrl + "\""); }
 void Sim900Client::enter_HttpAction() { sendCmd("AT+HTTPACTION=0"); }
 void Sim900Client::enter_HttpRead() { sendCmd("AT+HTTPREAD"); }
+void Sim900Client::enter_ClockQuery() { sendCmd("AT+CCLK?"); }
+void Sim900Client::enter_SetClip() { sendCmd("AT+CLIP=1"); }
+void Sim900Client::enter_SetSmsText() { sendCmd("AT+CMGF=1"); }
+void Sim900Client::enter_SetSmsNotify() { sendCmd("AT+CNMI=2,2,0,0,0"); } // push SMS as +CMT
+// Slow clock needs DTR to wake the modem; without it keep the modem awake
+void Sim900Client::enter_SetSlowClock() { sendCmd(MODEM_DTR_PIN >= 0 ? "AT+CSCLK=1" : "AT+CSCLK=0"); }
+void Sim900Client::enter_SmsRead() { sendCmd(String("AT+CMGR=") + smsToRead); }
+void Sim900Client::enter_SmsDelete() {
+  sendCmd(String("AT+CMGD=") + smsToRead);
+  smsToRead = -1;
+}
+void Sim900Client::enter_Hangup() { sendCmd("ATH"); }
 
 const Sim900Client::StateDef& Sim900Client::defFor(State s) const {
   return STATE_TABLE[(int)s];
@@ -220,7 +577,12 @@ const Sim900Client::StateDef& Sim900Client::defFor(State s) const {
 
 // name, onEnter, timeoutMs, onTimeout, onComplete, expectedToken
 const Sim900Client::StateDef Sim900Client::STATE_TABLE[] = {
-  { "Idle",         &Sim900Client::enter_NoOp,      0,        Error,      Idle,        NULL },
+  { "Idle",         &Sim900Client::enter_Idle,         0,     Error,      Idle,        NULL },
+  { "WakeModem",    &Sim900Client::enter_WakeModem,    MODEM_WAKE_MS, Idle /* -> resumeState */, Idle, NULL },
+  { "SetClip",      &Sim900Client::enter_SetClip,      3000,  SetSmsText /* ignore error */,   SetSmsText,   "OK" },
+  { "SetSmsText",   &Sim900Client::enter_SetSmsText,   3000,  SetSmsNotify /* ignore error */, SetSmsNotify, "OK" },
+  { "SetSmsNotify", &Sim900Client::enter_SetSmsNotify, 3000,  SetSlowClock /* ignore error */, SetSlowClock, "OK" },
+  { "SetSlowClock", &Sim900Client::enter_SetSlowClock, 3000,  StartBearer0 /* ignore error */, StartBearer0, "OK" },
   { "StartBearer0", &Sim900Client::enter_StartBearer0, 5000,  SetContype  /* ignore error */,      SetContype,  "OK" },
   { "SetContype",   &Sim900Client::enter_SetContype,   3000,  Error,      SetApn,      "OK" },
   { "SetApn",       &Sim900Client::enter_SetApn,       5000,  Error,      Attach,      "OK" },
@@ -232,6 +594,10 @@ const Sim900Client::StateDef Sim900Client::STATE_TABLE[] = {
   { "HttpUrl",      &Sim900Client::enter_HttpUrl,      3000,  Error,      HttpAction,  "OK" },
   { "HttpAction",   &Sim900Client::enter_HttpAction,   5000,  Error,      HttpRead,    "+HTTPACTION:" },
   { "HttpRead",     &Sim900Client::enter_HttpRead,     10000,  Error,      Idle,        "+HTTPREAD:" },
+  { "ClockQuery",   &Sim900Client::enter_ClockQuery,   3000,  Idle,       Idle,        "OK" },
+  { "SmsRead",      &Sim900Client::enter_SmsRead,      5000,  SmsDelete,  SmsDelete,   "OK" },
+  { "SmsDelete",    &Sim900Client::enter_SmsDelete,    5000,  Idle,       Idle,        "OK" },
+  { "Hangup",       &Sim900Client::enter_Hangup,       3000,  Idle,       Idle,        "OK" },
   { "Error",        &Sim900Client::enter_Error,         5000,  StartBearer0, Error,     NULL }
   //When error state times out, it will transition to StartBearer0 to retry the connection
 };
@@ -254,29 +620,196 @@ namespace {
 }
 
 namespace ParserServer {
-  struct PendingStatus {
-    volatile bool has;
-    long id;
-    uint8_t status;
-    uint8_t remainingMinutes;
-  };
-  static PendingStatus g_pending = { false, 0, 0, 0 };
-
-  bool consumePendingStatus(String& outUrl) {
-    if (!g_pending.has) return false;
-    outUrl = buildStatusUrl(g_pending.id, g_pending.status, g_pending.remainingMinutes);
-    g_pending.has = false;
+  String readField(const String& s, const char* key) {
+    return readFieldValue(s, key);
+  }
+
+  static long g_lastId = -1;
+  static uint8_t g_lastStatus = 0xFF;
+  static bool g_statusChanged = false;
+
+  bool consumeStatusChanged() {
+    bool changed = g_statusChanged;
+    g_statusChanged = false;
+    return changed;
+  }
+
+  // 32-bit FNV-1a over the raw body bytes; the server sends the same value
+  // back as an empty "unchanged" response when given it in &h=<hex>
+  uint32_t bodyHash(const String& body) {
+    uint32_t h = 2166136261UL;
+    for (unsigned int i = 0; i < body.length(); i++) {
+      h ^= (uint8_t)body[i];
+      h *= 16777619UL;
+    }
+    return h;
+  }
+
+  // Compact record (see COMPACT_PAYLOAD in Config.h):
+  //   "B:" + base64url(12 or 16 bytes, no padding)
+  //   [0] version  [1..4] id LE  [5..6] zone bitmask LE (bit z-1 = zone z)
+  //   [7] T  [8] M  [9] S
+  //   version 1: [10..11] CRC-16/CCITT-FALSE of bytes 0..9, LE
+  //   version 2: [10..11] L LE  [12..13] schedule version LE (0xFFFF = none)
+  //              [14..15] CRC-16/CCITT-FALSE of bytes 0..13, LE
+  static const uint8_t kCompactLenV1 = 12;
+  static const uint8_t kCompactLenV2 = 16;
+  static const uint16_t kCompactNoVersion = 0xFFFF;
+
+  static int8_t base64UrlValue(char c) {
+    if (c >= 'A' && c <= 'Z') return (int8_t)(c - 'A');
+    if (c >= 'a' && c <= 'z') return (int8_t)(c - 'a' + 26);
+    if (c >= '0' && c <= '9') return (int8_t)(c - '0' + 52);
+    if (c == '-') return 62;
+    if (c == '_') return 63;
+    return -1;
+  }
+
+  static uint16_t crc16Ccitt(const uint8_t* p, uint8_t len) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < len; i++) {
+      crc ^= (uint16_t)p[i] << 8;
+      for (uint8_t b = 0; b < 8; b++) {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+      }
+    }
+    return crc;
+  }
+
+  // First len bytes of the base64url text at payload[start]
+  static bool decodeBase64Url(const String& payload, unsigned int start, uint8_t* out, uint8_t len) {
+    uint16_t acc = 0;
+    uint8_t bits = 0;
+    uint8_t n = 0;
+    for (unsigned int i = start; n < len; i++) {
+      if (i >= payload.length()) return false;
+      int8_t v = base64UrlValue(payload[i]);
+      if (v < 0) return false;
+      acc = (uint16_t)((acc << 6) | (uint8_t)v);
+      bits += 6;
+      if (bits >= 8) {
+        bits -= 8;
+        out[n++] = (uint8_t)(acc >> bits);
+        acc &= (uint16_t)((1U << bits) - 1);
+      }
+    }
     return true;
   }
+
+  static uint16_t le16(const uint8_t* p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+  }
+
+  // Record bytes with a good CRC; returns their count, 0 if unusable
+  static uint8_t decodeCompact(const String& payload, uint8_t* raw) {
+    const unsigned int start = sizeof(COMPACT_PAYLOAD_PREFIX) - 1;
+    if (!decodeBase64Url(payload, start, raw, 1)) return 0;
+    uint8_t len = raw[0] == 1 ? kCompactLenV1 : raw[0] == 2 ? kCompactLenV2 : 0;
+    if (len == 0 || !decodeBase64Url(payload, start, raw, len)) return 0;
+    if (le16(raw + len - 2) != crc16Ccitt(raw, (uint8_t)(len - 2))) return 0;
+    return len;
+  }
+
+  bool isCompactPayload(const String& payload) {
+    return payload.startsWith(COMPACT_PAYLOAD_PREFIX);
+  }
+
+  IrrigationCommand parseCompact(const String& payload) {
+    IrrigationCommand cmd;
+    uint8_t raw[kCompactLenV2];
+    uint8_t len = decodeCompact(payload, raw);
+    if (len == 0) return cmd;
+
+    cmd.id = (long)((uint32_t)raw[1] | ((uint32_t)raw[2] << 8) |
+                    ((uint32_t)raw[3] << 16) | ((uint32_t)raw[4] << 24));
+    uint16_t mask = le16(raw + 5);
+    for (uint8_t z = 1; z <= ZONES_MAX; z++) {
+      if (mask & (1U << (z - 1))) cmd.zones[cmd.numZones++] = z;
+    }
+    cmd.totalMinutes = raw[7];
+    cmd.remainingMinutes = raw[8];
+    cmd.status = raw[9];
+    if (len == kCompactLenV2) cmd.targetLiters = le16(raw + 10);
+    cmd.valid = true;
+    return cmd;
+  }
+
+  long announcedScheduleVersion(const String& body) {
+    String v = readField(body, "V");
+    if (v.length() > 0) return v.toInt();
+    // Otherwise the first version-2 compact record that carries one
+    int at = body.indexOf(COMPACT_PAYLOAD_PREFIX);
+    while (at >= 0) {
+      uint8_t raw[kCompactLenV2];
+      if ((at == 0 || body[at - 1] == '\n') &&
+          decodeCompact(body.substring(at), raw) == kCompactLenV2 &&
+          le16(raw + 12) != kCompactNoVersion) {
+        return le16(raw + 12);
+      }
+      at = body.indexOf(COMPACT_PAYLOAD_PREFIX, at + 1);
+    }
+    return -1;
+  }
+
+  uint8_t parseBatch(const String& body, IrrigationCommand* out, uint8_t max, bool& corruptCompact) {
+    uint8_t n = 0;
+    corruptCompact = false;
+    unsigned int start = 0;
+    while (start < body.length()) {
+      int nl = body.indexOf('\n', start);
+      String line = (nl >= 0) ? body.substring(start, nl) : body.substring(start);
+      start = (nl >= 0) ? (unsigned int)nl + 1 : body.length();
+      line.trim();
+      if (line.length() == 0) continue;
+      IrrigationCommand cmd = parsePayload(line);
+      if (!cmd.valid) {
+        // V= and other non-command lines are fine; a bad "B:" record is not
+        if (isCompactPayload(line)) corruptCompact = true;
+        continue;
+      }
+      // A later record for the same irrigation supersedes the earlier one
+      uint8_t i = 0;
+      while (i < n && out[i].id != cmd.id) i++;
+      if (i < n) {
+        out[i] = cmd;
+        continue;
+      }
+      if (n < max) {
+        out[n++] = cmd;
+        continue;
+      }
+      // Full: keep the oldest pending irrigations (lowest ids), which are
+      // applied first anyway; the newer ones come with a later poll
+      uint8_t newest = 0;
+      for (uint8_t j = 1; j < n; j++) {
+        if (out[j].id > out[newest].id) newest = j;
+      }
+      if (cmd.id < out[newest].id) out[newest] = cmd;
+    }
+    // Apply in id order (insertion sort, n is tiny)
+    for (uint8_t i = 1; i < n; i++) {
+      IrrigationCommand c = out[i];
+      uint8_t j = i;
+      while (j > 0 && out[j - 1].id > c.id) {
+        out[j] = out[j - 1];
+        j--;
+      }
+      out[j] = c;
+    }
+    return n;
+  }
+
   IrrigationCommand parsePayload(const String& payload) {
     IrrigationCommand cmd; // default-initialized
     if (payload.length() == 0) return cmd;
+    if (isCompactPayload(payload)) return parseCompact(payload);
 
     String idStr = readFieldValue(payload, "ID");
     String zStr  = readFieldValue(payload, "Z");
     String tStr  = readFieldValue(payload, "T");
     String mStr  = readFieldValue(payload, "M");
     String sStr  = readFieldValue(payload, "S");
+    String lStr  = readFieldValue(payload, "L"); // optional volume target
 
     if (idStr.length() == 0 || sStr.length() == 0) {
       return cmd;
@@ -286,6 +819,7 @@ namespace ParserServer {
     cmd.totalMinutes = (uint8_t) tStr.toInt();
     cmd.remainingMinutes = (uint8_t) mStr.toInt();
     cmd.status = (uint8_t) sStr.toInt();
+    if (lStr.length() > 0) cmd.targetLiters = (uint16_t) lStr.toInt();
 
     // Parse zones (comma-separated) into a list with capacity ZONES_MAX
     int start = 0;
@@ -311,7 +845,8 @@ namespace ParserServer {
     return cmd;
   }
 
-  String buildStatusUrl(long id, uint8_t status, uint8_t remainingMinutes) {
+  String buildStatusUrl(long id, uint8_t status, uint8_t remainingMinutes,
+                        uint16_t liters, uint8_t fault) {
     if (strlen(STATUS_UPDATE_BASE) == 0) return String();
     String url = STATUS_UPDATE_BASE;
     url += "?id="; url += id;
@@ -319,15 +854,36 @@ namespace ParserServer {
     url += "&m="; url += remainingMinutes;
     url += "&s="; url += status;
     url += "&c="; url += STATUS_UPDATE_CONST_C;
+    if (FLOW_METER_ENABLED) {
+      url += "&v="; url += liters;
+      if (fault) { url += "&e="; url += fault; }
+    }
     return url;
   }
 
-  void sendStatusUpdate(long id, uint8_t status, uint8_t remainingMinutes) {
-    // Enqueue instead of sending immediately; Sim900 will push when idle
-    g_pending.id = id;
-    g_pending.status = status;
-    g_pending.remainingMinutes = remainingMinutes;
-    g_pending.has = true;
+  void sendStatusUpdate(long id, uint8_t status, uint8_t remainingMinutes,
+                        uint16_t liters, uint8_t fault) {
+    // Enqueue instead of sending immediately; Sim900 will push when idle.
+    // A repeat of the last status only refreshes the remaining minutes and
+    // yields to everything else; a transition outranks polls.
+    bool transition = (id != g_lastId || status != g_lastStatus);
+    ModemJob job = ModemJob();
+    job.kind = transition ? JobStatus : JobMinute;
+    job.priority = transition ? PrioHigh : PrioLow;
+    job.enqueuedAt = millis();
+    job.id = id;
+    job.status = status;
+    job.minutes = remainingMinutes;
+    job.liters = liters;
+    job.fault = fault;
+    // Older minute updates for this irrigation are stale either way
+    modemJobs.dropStatusUpdates(id, JobMinute);
+    modemJobs.push(job);
+    if (transition) {
+      g_lastId = id;
+      g_lastStatus = status;
+      g_statusChanged = true;
+    }
 
     //Serial.print("Status update queued: id="); Serial.print(id);
     //Serial.print(" s="); Serial.print(status);
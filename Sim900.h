@@ -7,8 +7,11 @@
 
 #include <SoftwareSerial.h>
 #include "Config.h"
+#include "PollScheduler.h"
+#include "ModemJobs.h"
+#include "Watchdog.h"
+#include "IrrigationCommand.h"
 
-struct IrrigationCommand; // forward declaration
 class Sim900Client {
 public:
   Sim900Client();
@@ -21,7 +24,20 @@ public:
   bool hasNewResponse() const;
   String takeResponse();
 
-  // Test helper: only handles polling/HTTP GET scheduling and poll logs
+  void setPollUrgency(PollUrgency u) { poller.setUrgency(u); }
+
+  // Offline schedule support; requests are served when the modem is idle
+  bool requestScheduleFetch();
+  bool requestClockSync();
+  bool takeScheduleBody(String& out);
+  bool takeClockReading(String& out); // "yy/MM/dd,hh:mm:ss+zz"
+  long serverScheduleVersion() const { return scheduleVersion; } // -1 if never announced
+  void printStats(Print& out) const;
+  uint32_t msUntilNextWork(uint32_t now) const; // for low-power idle; 0 = work now
+
+  // Test helper: only handles polling/HTTP GET scheduling and poll logs.
+  // A poll body can hold several records; each call hands out the next one
+  // (returns 0) before any new modem work is started.
   int pollAndProcess(IrrigationCommand& cmd);
 
 private:
@@ -29,6 +45,11 @@ private:
 
   enum State {
     Idle,
+    WakeModem,
+    SetClip,
+    SetSmsText,
+    SetSmsNotify,
+    SetSlowClock,
     StartBearer0,
     SetContype,
     SetApn,
@@ -39,12 +60,34 @@ private:
     HttpUrl,
     HttpAction,
     HttpRead,
+    ClockQuery,
+    SmsRead,
+    SmsDelete,
+    Hangup,
     Error
   };
 
+  enum Request {
+    ReqNone,
+    ReqPoll,
+    ReqStatus,
+    ReqSchedule
+  };
+
+  // Last record applied for a recent irrigation
+  struct AppliedRecord {
+    long id;
+    uint32_t hash;
+  };
+
+  int runJob(const ModemJob& job, uint32_t now);
+  bool nextBatchCommand(IrrigationCommand& cmd);
+  bool markApplied(const IrrigationCommand& c);
   void changeState(State s, const char* reason);
   void sendCmd(const String& cmd);
   void readIntoBuffer();
+  void onLine(const String& line); // unsolicited result code detection
+  bool senderAllowed(const String& line) const;
   void clearBuffer();
   const StateDef& defFor(State s) const;
 
@@ -59,18 +102,61 @@ private:
   void enter_HttpUrl();
   void enter_HttpAction();
   void enter_HttpRead();
-  void enter_NoOp(); // for Idle
+  void enter_ClockQuery();
+  void enter_SetClip();
+  void enter_SetSmsText();
+  void enter_SetSmsNotify();
+  void enter_SetSlowClock();
+  void enter_WakeModem();
+  void enter_SmsRead();
+  void enter_SmsDelete();
+  void enter_Hangup();
+  void enter_Idle();
   void enter_Error(); //for error
 
   Stream* sim;
   State state;
+  State resumeState; // where to go once WakeModem has raised the modem
   unsigned long stateSince;
   unsigned long stateTimeout;
   String buffer;
   String currentUrl;
   String lastBody;
   bool newResponse;
-  unsigned long nextPollAt;
+  PollScheduler poller;
+  Request inFlight;  // what the pending response answers
+  String scheduleBody;
+  bool scheduleReady;
+  String clockReading;
+  bool clockReady;
+  long scheduleVersion;
+  String urcLine;       // current line, scanned for URCs in every state
+  unsigned int urcLineStart; // where urcLine begins in buffer
+  bool hangupPending;
+  bool smsTextNext;     // next line is the text of a pushed SMS
+  int smsToRead;        // +CMTI storage index waiting for AT+CMGR, -1 if none
+  uint32_t statWakes;
+  uint8_t compactSkip;    // polls left that ask for text only
+  uint8_t compactPenalty; // compactSkip after the next corrupt compact reply
+  bool hasBodyHash;
+  uint32_t lastBodyHash; // hash of the last command body acted upon
+  // Records of the last poll body, handed out one per pollAndProcess() call
+  IrrigationCommand batch[POLL_MAX_RECORDS];
+  uint8_t batchCount;
+  uint8_t batchNext;
+  // The server keeps listing a record until it is done, so an unchanged one
+  // is not applied again; like the body hash, this is forgotten on every
+  // local transition
+  AppliedRecord applied[POLL_MAX_RECORDS];
+  uint8_t appliedCount;
+  uint8_t appliedNext;
+  uint32_t statPolls;
+  uint32_t statUnchanged;
+  uint32_t statBodyBytes;
+  uint32_t statStaleRecords;
+  bool resetReportInFlight; // the pending status upload carries &r=/&b=
+  bool pollBlocked;          // idle modem, poll due, not started yet
+  uint32_t pollBlockedSince;
 
   // State table definition
   struct StateDef {
@@ -85,10 +171,22 @@ private:
 };
 
 namespace ParserServer {
-  IrrigationCommand parsePayload(const String& payload);
-  bool consumePendingStatus(String& outUrl);
-  String buildStatusUrl(long id, uint8_t status, uint8_t remainingMinutes);
-  void sendStatusUpdate(long id, uint8_t status, uint8_t remainingMinutes);
+  IrrigationCommand parsePayload(const String& payload); // text or compact
+  String readField(const String& s, const char* key);     // "KEY=value;" lookup
+  IrrigationCommand parseCompact(const String& payload);
+  // V= of the body, else the version in a version-2 compact record; -1 if none
+  long announcedScheduleVersion(const String& body);
+  // One record per line, later lines for an id replacing earlier ones,
+  // returned in id order; past max the lowest ids are kept. corruptCompact
+  // is set if a "B:" line was unusable.
+  uint8_t parseBatch(const String& body, IrrigationCommand* out, uint8_t max, bool& corruptCompact);
+  bool isCompactPayload(const String& payload);
+  uint32_t bodyHash(const String& body);
+  bool consumeStatusChanged();
+  String buildStatusUrl(long id, uint8_t status, uint8_t remainingMinutes,
+                        uint16_t liters = 0, uint8_t fault = 0);
+  void sendStatusUpdate(long id, uint8_t status, uint8_t remainingMinutes,
+                        uint16_t liters = 0, uint8_t fault = 0);
 }
 
 #endif
@@ -0,0 +1,147 @@
+#include "Watchdog.h"
+#include "EepromStore.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+
+Watchdog watchdog;
+
+static_assert(WATCHDOG_STALL_MS > LOW_POWER_MAX_IDLE_MS,
+              "subsystems do not check in while the board sleeps");
+
+static const uint16_t kCrashMagic = 0xC4A5;
+
+// Left alone by the C runtime, so they survive a watchdog reset
+struct CrashNote {
+  uint16_t magic;
+  uint8_t cause;
+  uint8_t subsystem;
+};
+static CrashNote g_crash __attribute__((section(".noinit")));
+static volatile uint8_t g_breadcrumb __attribute__((section(".noinit")));
+static uint8_t g_resetFlags __attribute__((section(".noinit")));
+
+// Runs before main(): keep the reset flags and stop the watchdog, which stays
+// on with its shortest timeout after a watchdog reset
+void captureResetFlags() __attribute__((naked, used, section(".init3")));
+void captureResetFlags() {
+  g_resetFlags = MCUSR;
+  MCUSR = 0;
+  wdt_disable();
+}
+
+// First timeout: loop() has not fed us for WDTO_4S. Note where it was stuck;
+// the next timeout resets the board.
+ISR(WDT_vect) {
+  if (g_crash.magic == kCrashMagic) return; // stall or critical already noted
+  g_crash.magic = kCrashMagic;
+  g_crash.cause = ResetHang;
+  g_crash.subsystem = g_breadcrumb;
+}
+
+static const char* const SUBSYSTEM_NAMES[SubCount] = {
+  "modem", "poller", "irrigation", "schedule", "peerlink", "main"
+};
+
+Watchdog::Watchdog()
+  : stalled(false) {
+  for (uint8_t i = 0; i < SubCount; i++) lastCheckIn[i] = 0;
+}
+
+bool Watchdog::supervised(uint8_t subsystem) {
+  return subsystem == SubPoller || subsystem == SubIrrigation;
+}
+
+void Watchdog::begin() {
+  uint8_t cause = ResetUnknown;
+  uint8_t subsystem = SubMain;
+  if (g_resetFlags & _BV(PORF)) {
+    cause = ResetPowerOn; // RAM content is random after power-up
+  } else if (g_crash.magic == kCrashMagic) {
+    cause = g_crash.cause;
+    subsystem = g_crash.subsystem < SubCount ? g_crash.subsystem : (uint8_t)SubMain;
+  } else if (g_resetFlags & _BV(WDRF)) {
+    cause = ResetHang; // interrupt never ran; the breadcrumb still holds
+    if (g_breadcrumb < SubCount) subsystem = g_breadcrumb;
+  } else if (g_resetFlags & _BV(BORF)) {
+    cause = ResetBrownOut;
+  } else if (g_resetFlags & _BV(EXTRF)) {
+    cause = ResetExternal;
+  }
+  g_crash.magic = 0;
+  g_breadcrumb = SubMain;
+
+  if (!EepromStore::loadResetRecord(last)) last.resets = 0;
+  last.cause = cause;
+  last.subsystem = subsystem;
+  last.reported = 0;
+  last.resets++;
+  EepromStore::saveResetRecord(last);
+  Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Reset cause="); Serial.print(cause);
+  Serial.print(" in "); Serial.println(SUBSYSTEM_NAMES[subsystem]);
+
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < SubCount; i++) lastCheckIn[i] = now;
+  if (WATCHDOG_ENABLED) {
+    wdt_enable(WDTO_4S);
+    WDTCSR |= _BV(WDIE); // interrupt first, reset on the following timeout
+  }
+}
+
+void Watchdog::enter(uint8_t subsystem) {
+  g_breadcrumb = subsystem;
+}
+
+void Watchdog::checkIn(uint8_t subsystem) {
+  if (supervised(subsystem)) lastCheckIn[subsystem] = millis();
+}
+
+void Watchdog::service() {
+  if (!WATCHDOG_ENABLED || stalled) return;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < SubCount; i++) {
+    if (supervised(i) && now - lastCheckIn[i] > WATCHDOG_STALL_MS) {
+      // Stop feeding; the hardware watchdog resets us within seconds
+      stalled = true;
+      g_crash.magic = kCrashMagic;
+      g_crash.cause = ResetStall;
+      g_crash.subsystem = i;
+      Serial.print("["); Serial.print(ROLE_NAME); Serial.print("] Watchdog: ");
+      Serial.print(SUBSYSTEM_NAMES[i]); Serial.println(" stalled, resetting");
+      return;
+    }
+  }
+  wdt_reset();
+  if (!(WDTCSR & _BV(WDIE))) {
+    // A slow pass tripped the interrupt but loop() came back: not a hang
+    g_crash.magic = 0;
+    WDTCSR |= _BV(WDIE);
+  }
+}
+
+void Watchdog::critical() {
+  stalled = true;
+  g_crash.magic = kCrashMagic;
+  g_crash.cause = ResetCritical;
+  g_crash.subsystem = g_breadcrumb;
+}
+
+bool Watchdog::pendingReport(uint8_t& cause, uint8_t& subsystem) const {
+  if (last.reported) return false;
+  cause = last.cause;
+  subsystem = last.subsystem;
+  return true;
+}
+
+void Watchdog::reportSent() {
+  if (last.reported) return;
+  last.reported = 1;
+  EepromStore::saveResetRecord(last);
+}
+
+void Watchdog::printStats(Print& out) const {
+  out.print("[wdt] lastReset="); out.print(last.cause);
+  out.print(" in "); out.print(SUBSYSTEM_NAMES[last.subsystem < SubCount ? last.subsystem : (uint8_t)SubMain]);
+  out.print(" resets="); out.print(last.resets);
+  out.print(" reported="); out.println(last.reported);
+}
@@ -0,0 +1,71 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Code areas of loop(). The current one is kept as a breadcrumb that
+// survives a watchdog reset; the supervised ones must also check in.
+// The values are reported to the server (&b=), keep them stable.
+enum Subsystem {
+  SubModem,       // Sim900Client state machine; every state times out on its own
+  SubPoller,      // supervised: checks in unless an idle modem keeps not starting a due poll
+  SubIrrigation,  // supervised: IrrigationManager::tick()
+  SubSchedule,
+  SubPeerLink,
+  SubMain,        // the rest of loop(), including low-power idle
+  SubCount
+};
+
+enum ResetCause {
+  ResetUnknown,
+  ResetPowerOn,
+  ResetExternal,  // reset pin
+  ResetBrownOut,
+  ResetHang,      // loop() stopped; the breadcrumb names where
+  ResetStall,     // loop() ran but a subsystem stopped checking in
+  ResetCritical   // criticalError()
+};
+
+// Last reset as stored in EEPROM until it has been reported to the server
+struct ResetRecord {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t cause;      // ResetCause
+  uint8_t subsystem;  // Subsystem breadcrumb
+  uint8_t reported;
+  uint16_t resets;    // boots since the record was created
+  uint16_t checksum;
+};
+
+// AVR watchdog with progress supervision. The hardware watchdog is fed from
+// loop() only while every supervised subsystem has checked in recently, so a
+// hang (or a subsystem that stops making progress) resets the board and
+// every output relay drops with the pins. The first watchdog timeout runs an
+// interrupt that records the breadcrumb; the second one resets.
+class Watchdog {
+public:
+  Watchdog();
+
+  void begin();                   // record why we came up, then arm
+  void enter(uint8_t subsystem);  // breadcrumb: about to run this subsystem
+  void checkIn(uint8_t subsystem);
+  void service();                 // feed the watchdog if nothing has stalled
+  void critical();                // criticalError(): reset with this cause
+
+  // Reset info for the next status upload (&r=<cause>&b=<subsystem>)
+  bool pendingReport(uint8_t& cause, uint8_t& subsystem) const;
+  void reportSent();
+  void printStats(Print& out) const;
+
+private:
+  static bool supervised(uint8_t subsystem);
+
+  ResetRecord last;
+  uint32_t lastCheckIn[SubCount];
+  bool stalled;
+};
+
+extern Watchdog watchdog;
+
+#endif
@@ -5,13 +5,26 @@
 #include "Pins.h"
 #include "Sim900.h"
 #include "Irrigation.h"
+#include "ModemTrace.h"
+#include "Schedule.h"
+#include "PeerLink.h"
+#include "PowerManager.h"
+#include "FlowMeter.h"
+#include "Watchdog.h"
 
 SoftwareSerial sim900ss(SIM900_TX_PIN, SIM900_RX_PIN);
+ModemTrace modemTrace;
 Sim900Client sim900Client;
 IrrigationManager irrigation(sim900Client);
+ScheduleEngine schedule(irrigation, sim900Client);
+PeerLink peerLink;
+PowerManager power;
+FlowMeter flowMeter;
 
 
 static void criticalError(const char* msg); 
+static void handleConsole();
+static void sleepUntilNextWork();
 
 void setup() {
   Serial.begin(SERIAL_BAUD);
@@ -19,6 +32,8 @@ void setup() {
   // Prepare error LED early
   pinMode(ERROR_LED_PIN, OUTPUT);
   digitalWrite(ERROR_LED_PIN, LOW);
+  initPinsForRole(ROLE);
+  watchdog.begin();
   // Wait briefly for Serial to become ready (on boards that support it)
   unsigned long start = millis();
   while (!Serial && (millis() - start) < SERIAL_READY_TIMEOUT_MS) { /* wait */ }
@@ -26,23 +41,90 @@ void setup() {
     criticalError("Serial not ready");
   }
 
-  initPinsForRole(ROLE);
-  sim900Client.begin(sim900ss);
+  modemTrace.begin(sim900ss);
+  sim900Client.begin(modemTrace);
   // sim900Client.begin(Serial); //NOTE: This is for testing purposes only, SoftwareSerial is used for the actual hardware.
+  if (PEER_LINK_ENABLED) {
+    Serial1.begin(PEER_LINK_BAUD);
+    peerLink.begin(Serial1);
+    irrigation.setPeerLink(&peerLink);
+  }
+  if (FLOW_METER_ENABLED) {
+    flowMeter.begin();
+    irrigation.setFlowMeter(&flowMeter);
+  }
   irrigation.begin();
+  schedule.begin();
+  power.watch(sim900ss);
+  power.watch(Serial);
+  if (PEER_LINK_ENABLED) power.watch(Serial1);
   Serial.println("Irrigation program ready [ROLE=" + String(ROLE_NAME) + "]");
 }
 
 void loop() {
+  watchdog.enter(SubModem);
   sim900Client.loop();
+  sim900Client.setPollUrgency(irrigation.pollUrgency());
   IrrigationCommand cmd;
-  int result = sim900Client.pollAndProcess(cmd);
-  if (result == 0) irrigation.onServerCommand(cmd);
+  // A poll body may carry several records; apply them all in one pass
+  watchdog.enter(SubPoller);
+  while (sim900Client.pollAndProcess(cmd) == 0) irrigation.onServerCommand(cmd);
+  if (PEER_LINK_ENABLED) {
+    watchdog.enter(SubPeerLink);
+    peerLink.loop();
+    PeerStatus ps;
+    if (peerLink.receive(ps)) irrigation.onPeerStatus(ps);
+  }
+  watchdog.enter(SubIrrigation);
   irrigation.tick();
+  watchdog.enter(SubSchedule);
+  schedule.tick();
+  watchdog.enter(SubMain);
+  handleConsole();
+  watchdog.service();
+  // Without DTR the modem never enters slow-clock mode
+  power.account(MODEM_DTR_PIN < 0 || !sim900Client.isIdle());
+  if (LOW_POWER_IDLE) sleepUntilNextWork();
+}
+
+// Idle-sleep until the earliest deadline of any subsystem
+static void sleepUntilNextWork() {
+  uint32_t now = millis();
+  uint32_t wait = sim900Client.msUntilNextWork(now);
+  uint32_t t = irrigation.msUntilNextTick(now);
+  if (t < wait) wait = t;
+  t = schedule.msUntilNextWork(now);
+  if (t < wait) wait = t;
+  if (PEER_LINK_ENABLED) {
+    t = peerLink.msUntilNextEvent(now);
+    if (t < wait) wait = t;
+  }
+  power.idle(wait);
+}
+
+// Single-character commands on the USB serial port
+static void handleConsole() {
+  if (!Serial.available()) return;
+  char c = (char)Serial.read();
+  if (c == 'd') {
+    modemTrace.dump(Serial);
+  } else if (c == 's') {
+    sim900Client.printStats(Serial);
+    if (PEER_LINK_ENABLED) peerLink.printStats(Serial);
+    if (FLOW_METER_ENABLED) flowMeter.printStats(Serial);
+    power.printStats(Serial);
+    watchdog.printStats(Serial);
+  } else if (c == 'c') {
+    modemTrace.clear();
+    Serial.println("Modem trace cleared");
+  }
 }
 
 static void criticalError(const char* msg) {
-  // Turn on error LED and halt
+  // Valves and pump off, error LED on, then halt until the watchdog resets
+  // the board (it is armed in setup() before anything can fail)
+  allOutputsOff();
+  watchdog.critical();
   pinMode(ERROR_LED_PIN, OUTPUT);
   digitalWrite(ERROR_LED_PIN, HIGH);
   // Best-effort log if Serial happens to be available
@@ -0,0 +1,128 @@
+// The flow meter on the booted sketch (MASTER, FLOW_METER_ENABLED): pulses
+// come from the host time hook while loop() runs, at a set rate whenever
+// the pump relay is on, so they land in the middle of modem waits and
+// sleeps just as on the board. A no-flow or over-flow fault stops the run,
+// an L= target completes it, and every status update carries v=.
+
+#include "HostTest.h"
+#include "Firmware.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+
+namespace {
+  ModemEmulator modem;
+  SiteServer site;
+
+  // The pending irrigation, listed with the last status a board reported
+  long recordId = 0;
+  std::string recordFields;
+
+  std::string body(const std::string&) {
+    if (recordId == 0) return "";
+    int s = site.lastStatus(recordId);
+    return "ID=" + std::to_string(recordId) + ";" + recordFields + ";S=" +
+           std::to_string(s < 0 ? 1 : s);
+  }
+
+  bool pumpRunning() { return hostPinLevel(PUMP_PIN) == LOW; }
+
+  // Water on the main line: lpm while the pump runs, nothing otherwise
+  uint16_t lpm = 0;
+  uint32_t lastHookMs = 0;
+  uint64_t pumpedMsTimesLpm = 0;
+  uint32_t pulsesFired = 0;
+
+  void feed(uint32_t now) {
+    uint32_t dt = now - lastHookMs;
+    lastHookMs = now;
+    if (!pumpRunning()) return;
+    pumpedMsTimesLpm += (uint64_t)dt * lpm;
+    uint32_t due = (uint32_t)(pumpedMsTimesLpm * FLOW_PULSES_PER_LITER_X100 / 100 / 60000);
+    while (pulsesFired < due) {
+      pulsesFired++;
+      hostFireInterrupt(FLOW_METER_PIN);
+    }
+  }
+
+  // Start irrigation id with the given extra fields at lpm; true once the
+  // pump is on and the start has been reported
+  bool startRun(long id, const char* fields, uint16_t rate) {
+    lpm = rate;
+    recordId = id;
+    recordFields = fields;
+    return hostRunUntil([=] { return site.lastStatus(id) == (int)ThisRole::kStartStatus && pumpRunning(); },
+                        POLL_IDLE_MAX_INTERVAL_MS + 60000UL);
+  }
+
+  // Status updates for id, in order
+  std::vector<std::string> statusUrls(long id) {
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < site.updates.size(); i++) {
+      if (site.updates[i].id == id) urls.push_back(site.updates[i].url);
+    }
+    return urls;
+  }
+
+  // Every update for id reports the volume; only the last one may carry e=
+  bool everyUpdateHasVolume(long id) {
+    std::vector<std::string> urls = statusUrls(id);
+    for (size_t i = 0; i < urls.size(); i++) {
+      if (SiteServer::param(urls[i], "v").empty()) return false;
+      if (i + 1 < urls.size() && !SiteServer::param(urls[i], "e").empty()) return false;
+    }
+    return !urls.empty();
+  }
+}
+
+TEST(dry_well_stops_the_pump) {
+  modem.server = std::ref(site);
+  site.onPoll = body;
+  hostAttachModem(&modem);
+  hostSetTimeHook(feed);
+  setup();
+  // 1 L/min, under FLOW_MIN_LPM
+  CHECK(startRun(501, "Z=1,7;T=10;M=10", 1));
+  uint32_t startedAt = hostPinChangedAt(PUMP_PIN);
+  CHECK(hostRunUntil([] { return !pumpRunning(); }, FLOW_START_GRACE_MS + 3 * FLOW_CHECK_WINDOW_MS));
+  uint32_t stoppedAfter = hostPinChangedAt(PUMP_PIN) - startedAt;
+  REPORT("no flow: pump off %.1f s into the run", stoppedAfter / 1000.0);
+  CHECK(stoppedAfter >= FLOW_START_GRACE_MS + FLOW_CHECK_WINDOW_MS);
+  CHECK(hostRunUntil([] { return site.lastStatus(501) == (int)ThisRole::kStopStatus; }, 60000UL));
+  std::string last = statusUrls(501).back();
+  CHECK_EQ(SiteServer::param(last, "e"), std::to_string((int)FlowNone));
+  CHECK(everyUpdateHasVolume(501));
+  CHECK(!pumpRunning());
+}
+
+TEST(burst_pipe_stops_the_pump) {
+  // 70 L/min, over FLOW_MAX_LPM
+  CHECK(startRun(502, "Z=1,7;T=10;M=10", 70));
+  uint32_t fired = pulsesFired;
+  CHECK(hostRunUntil([] { return !pumpRunning(); }, FLOW_START_GRACE_MS + 3 * FLOW_CHECK_WINDOW_MS));
+  CHECK(hostRunUntil([] { return site.lastStatus(502) == (int)ThisRole::kStopStatus; }, 60000UL));
+  std::string last = statusUrls(502).back();
+  CHECK_EQ(SiteServer::param(last, "e"), std::to_string((int)FlowExcess));
+  // Every pulse the pump caused is in the volume reported
+  uint32_t liters = (pulsesFired - fired) * 100UL / FLOW_PULSES_PER_LITER_X100;
+  REPORT("burst: %u pulses, v=%s", (unsigned)(pulsesFired - fired), SiteServer::param(last, "v").c_str());
+  CHECK_EQ(SiteServer::param(last, "v"), std::to_string(liters));
+  CHECK(everyUpdateHasVolume(502));
+}
+
+TEST(volume_target_completes_the_run) {
+  // 20 L/min and L=10: done after 30 s of a 10-minute run
+  CHECK(startRun(503, "Z=1,7;T=10;M=10;L=10", 20));
+  uint32_t startedAt = hostPinChangedAt(PUMP_PIN);
+  CHECK(hostRunUntil([] { return !pumpRunning(); }, 10UL * 60000UL));
+  uint32_t ranFor = hostPinChangedAt(PUMP_PIN) - startedAt;
+  REPORT("L=10 at 20 L/min: pump off after %.1f s", ranFor / 1000.0);
+  CHECK(ranFor >= 30000UL);
+  CHECK(ranFor < 32000UL);
+  CHECK(hostRunUntil([] { return site.lastStatus(503) >= 0 &&
+                                 site.lastStatus(503) != (int)ThisRole::kStartStatus; }, 60000UL));
+  CHECK_EQ(site.lastStatus(503), (int)ThisRole::kCompleteStatus);
+  std::string last = statusUrls(503).back();
+  CHECK_EQ(SiteServer::param(last, "v"), std::string("10"));
+  CHECK_EQ(SiteServer::param(last, "e"), std::string());
+  CHECK(everyUpdateHasVolume(503));
+}
@@ -0,0 +1,188 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <SoftwareSerial.h>
+#include <stdio.h>
+
+static uint32_t g_millis = 0;
+static uint8_t g_pinLevel[HOST_PIN_COUNT];
+static uint32_t g_pinWrites[HOST_PIN_COUNT];
+static uint32_t g_pinChangedAt[HOST_PIN_COUNT];
+static void (*g_isr[HOST_PIN_COUNT])();
+static bool g_isrHeld[HOST_PIN_COUNT];
+static bool g_interruptsOff = false;
+static void (*g_timeHook)(uint32_t now) = NULL;
+static bool g_verbose = getenv("HOST_VERBOSE") != NULL;
+
+uint32_t millis() { return g_millis; }
+uint32_t micros() { return g_millis * 1000UL; }
+void delay(uint32_t ms) { hostAdvance(ms); }
+void delayMicroseconds(unsigned int) {}
+
+void hostSetMillis(uint32_t ms) { g_millis = ms; }
+
+void hostAdvance(uint32_t ms) {
+  g_millis += ms;
+  if (g_timeHook) g_timeHook(g_millis);
+}
+
+void hostSetTimeHook(void (*hook)(uint32_t now)) { g_timeHook = hook; }
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= HOST_PIN_COUNT) return;
+  uint8_t next = level ? HIGH : LOW;
+  if (next != g_pinLevel[pin]) g_pinChangedAt[pin] = g_millis;
+  g_pinLevel[pin] = next;
+  g_pinWrites[pin]++;
+}
+
+int digitalRead(uint8_t pin) { return pin < HOST_PIN_COUNT ? g_pinLevel[pin] : LOW; }
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+void attachInterrupt(int irq, void (*isr)(), int) {
+  if (irq >= 0 && irq < HOST_PIN_COUNT) g_isr[irq] = isr;
+}
+
+void detachInterrupt(int irq) {
+  if (irq >= 0 && irq < HOST_PIN_COUNT) g_isr[irq] = NULL;
+}
+
+void noInterrupts() { g_interruptsOff = true; }
+
+void interrupts() {
+  g_interruptsOff = false;
+  for (uint8_t i = 0; i < HOST_PIN_COUNT; i++) {
+    if (!g_isrHeld[i]) continue;
+    g_isrHeld[i] = false;
+    if (g_isr[i]) g_isr[i]();
+  }
+}
+
+uint8_t hostPinLevel(uint8_t pin) { return pin < HOST_PIN_COUNT ? g_pinLevel[pin] : LOW; }
+uint32_t hostPinWrites(uint8_t pin) { return pin < HOST_PIN_COUNT ? g_pinWrites[pin] : 0; }
+uint32_t hostPinChangedAt(uint8_t pin) { return pin < HOST_PIN_COUNT ? g_pinChangedAt[pin] : 0; }
+
+void hostFireInterrupt(uint8_t pin) {
+  if (pin >= HOST_PIN_COUNT || !g_isr[pin]) return;
+  if (g_interruptsOff) g_isrHeld[pin] = true;
+  else g_isr[pin]();
+}
+
+void hostResetPins() {
+  for (uint8_t i = 0; i < HOST_PIN_COUNT; i++) {
+    g_pinLevel[i] = LOW;
+    g_pinWrites[i] = 0;
+    g_pinChangedAt[i] = 0;
+  }
+}
+
+// --- String / Print ---
+
+static std::string formatNumber(unsigned long v, int base, bool upper) {
+  if (base < 2) base = 10;
+  const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  std::string r;
+  do {
+    r.insert(r.begin(), digits[v % base]);
+    v /= base;
+  } while (v);
+  return r;
+}
+
+// String(value, base) formats like ltoa/ultoa: lowercase, sign only in base 10
+void String::setNumber(long v, unsigned char base) {
+  if (base == DEC && v < 0) s = "-" + formatNumber((unsigned long)-v, base, false);
+  else s = formatNumber((unsigned long)v, base, false);
+}
+
+void String::setNumber(unsigned long v, unsigned char base) {
+  s = formatNumber(v, base, false);
+}
+
+size_t Print::printSigned(long v, int base) {
+  if (base == DEC && v < 0) return print('-') + printNumber((unsigned long)-v, base);
+  return printNumber((unsigned long)v, base);
+}
+
+// Print::print(value, HEX) uses uppercase digits
+size_t Print::printNumber(unsigned long v, int base) {
+  return write(formatNumber(v, base, true).c_str());
+}
+
+size_t Print::print(double v, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return write(buf);
+}
+
+// --- Serial ---
+
+int HardwareSerial::available() { return (int)in.size(); }
+
+int HardwareSerial::read() {
+  if (in.empty()) return -1;
+  int c = (uint8_t)in[0];
+  in.erase(0, 1);
+  return c;
+}
+
+int HardwareSerial::peek() { return in.empty() ? -1 : (uint8_t)in[0]; }
+
+size_t HardwareSerial::write(uint8_t b) {
+  out += (char)b;
+  if (out.size() > 1000000) out.erase(0, out.size() - 500000); // nobody reads that far back
+  if (g_verbose && this == &Serial) fputc(b, stdout);
+  return 1;
+}
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+// --- EEPROM ---
+
+EEPROMClass::EEPROMClass() { clear(); }
+void EEPROMClass::clear() { memset(bytes, 0xFF, sizeof(bytes)); }
+EEPROMClass EEPROM;
+
+// --- AVR registers and watchdog ---
+
+uint8_t MCUSR = 0;
+uint8_t WDTCSR = 0;
+static uint32_t g_wdtFeeds = 0;
+static uint32_t g_wdtLastFeedMs = 0;
+static uint32_t g_wdtLongestGapMs = 0;
+static bool g_wdtArmed = false;
+
+void wdt_enable(uint8_t) {
+  g_wdtArmed = true;
+  g_wdtLastFeedMs = g_millis;
+}
+
+void wdt_disable() { g_wdtArmed = false; }
+
+void wdt_reset() {
+  uint32_t gap = g_millis - g_wdtLastFeedMs;
+  if (g_wdtArmed && gap > g_wdtLongestGapMs) g_wdtLongestGapMs = gap;
+  g_wdtLastFeedMs = g_millis;
+  g_wdtFeeds++;
+}
+
+uint32_t hostWdtFeeds() { return g_wdtFeeds; }
+uint32_t hostWdtLastFeedMs() { return g_wdtLastFeedMs; }
+uint32_t hostWdtLongestGapMs() { return g_wdtLongestGapMs; }
+
+void hostWdtResetStats() {
+  g_wdtFeeds = 0;
+  g_wdtLastFeedMs = g_millis;
+  g_wdtLongestGapMs = 0;
+}
+
+// --- SoftwareSerial ---
+
+static Stream* g_modem = NULL;
+
+void hostAttachModem(Stream* modem) { g_modem = modem; }
+Stream* hostModem() { return g_modem; }
@@ -0,0 +1,198 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino core for building the firmware modules on a PC.
+// Time is virtual: millis() only moves when a test (or delay()/sleep_cpu())
+// advances it, so every run is deterministic.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define LED_BUILTIN 13
+
+#define HOST_PIN_COUNT 70
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(int irq, void (*isr)(), int mode);
+void detachInterrupt(int irq);
+void noInterrupts();
+void interrupts();
+
+// --- Host controls (not part of the Arduino API) ---
+void hostSetMillis(uint32_t ms);
+void hostAdvance(uint32_t ms);
+// Called with the new millis() each time delay(), sleep_cpu() or
+// hostAdvance() moves the clock, e.g. to feed a sensor while loop() runs
+void hostSetTimeHook(void (*hook)(uint32_t now));
+uint8_t hostPinLevel(uint8_t pin);
+uint32_t hostPinWrites(uint8_t pin);    // digitalWrite() calls so far
+uint32_t hostPinChangedAt(uint8_t pin); // millis() of the last level change
+// Run the ISR attached to pin. Between noInterrupts() and interrupts() it
+// is held, and like the AVR's flag one held request per pin is kept
+void hostFireInterrupt(uint8_t pin);
+void hostResetPins();
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s(s ? s : "") {}
+  String(const std::string& v) : s(v) {}
+  explicit String(char c) : s(1, c) {}
+  explicit String(unsigned char v, unsigned char base = DEC) { setNumber(v, base); }
+  explicit String(int v, unsigned char base = DEC) { setNumber(v, base); }
+  explicit String(unsigned int v, unsigned char base = DEC) { setNumber(v, base); }
+  explicit String(long v, unsigned char base = DEC) { setNumber(v, base); }
+  explicit String(unsigned long v, unsigned char base = DEC) { setNumber(v, base); }
+
+  unsigned int length() const { return (unsigned int)s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  char operator[](unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { if (o) s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  String& operator+=(unsigned char v) { s += std::to_string(v); return *this; }
+  String& operator+=(int v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned int v) { s += std::to_string(v); return *this; }
+  String& operator+=(long v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == (o ? o : ""); }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool equals(const String& o) const { return s == o.s; }
+
+  int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const String& n, unsigned int from = 0) const { return pos(s.find(n.s, from)); }
+  int lastIndexOf(char c) const { return pos(s.rfind(c)); }
+  int lastIndexOf(const String& n) const { return pos(s.rfind(n.s)); }
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const {
+    return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+  }
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= s.size()) return String();
+    if (to > s.size()) to = (unsigned int)s.size();
+    return String(s.substr(from, to - from));
+  }
+  void remove(unsigned int index) { if (index < s.size()) s.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < s.size()) s.erase(index, count); }
+  void trim() {
+    size_t b = s.find_first_not_of(" \t\r\n\f\v");
+    if (b == std::string::npos) { s.clear(); return; }
+    size_t e = s.find_last_not_of(" \t\r\n\f\v");
+    s = s.substr(b, e - b + 1);
+  }
+  long toInt() const { return atol(s.c_str()); }
+
+  const std::string& str() const { return s; }
+
+private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  void setNumber(long v, unsigned char base);
+  void setNumber(unsigned long v, unsigned char base);
+  void setNumber(int v, unsigned char base) { setNumber((long)v, base); }
+  void setNumber(unsigned int v, unsigned char base) { setNumber((unsigned long)v, base); }
+  void setNumber(unsigned char v, unsigned char base) { setNumber((unsigned long)v, base); }
+
+  std::string s;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, int b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, long b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, unsigned long b) { String r(a); r += b; return r; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) n += write(buf[i]);
+    return n;
+  }
+  size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return printNumber(v, base); }
+  size_t print(int v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned int v, int base = DEC) { return printNumber(v, base); }
+  size_t print(long v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned long v, int base = DEC) { return printNumber(v, base); }
+  size_t print(double v, int digits = 2);
+
+  size_t println() { return write((const uint8_t*)"\r\n", 2); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T& v, int base) { size_t n = print(v, base); return n + println(); }
+
+private:
+  size_t printSigned(long v, int base);
+  size_t printNumber(unsigned long v, int base);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
+
+// USB/hardware UART. Output is collected in a buffer (and echoed to stdout
+// when HOST_VERBOSE is set); input is whatever the test queued.
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  void end() {}
+  operator bool() const { return true; }
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t b);
+  using Print::write;
+
+  void hostInput(const std::string& text) { in += text; }
+  std::string& hostOutput() { return out; }
+
+private:
+  std::string in;
+  std::string out;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif
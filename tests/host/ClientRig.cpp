@@ -0,0 +1,60 @@
+#include "ClientRig.h"
+#include <chrono>
+
+ClientRig::ClientRig()
+  : cpuNs(0) {
+  modem.server = std::ref(site);
+}
+
+void ClientRig::begin() {
+  ModemJob job;
+  while (modemJobs.pop(millis(), job)) {}
+  ParserServer::consumeStatusChanged();
+  hostAttachModem(&modem);
+  client.begin(modem);
+  // Setup commands only; the first poll is left to the test
+  uint32_t start = millis();
+  while (!client.isIdle() && millis() - start < 60000UL) {
+    client.loop();
+    hostAdvance(1);
+  }
+}
+
+int ClientRig::step(IrrigationCommand& cmd, uint32_t maxWaitMs) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point t0 = Clock::now();
+  client.loop();
+  int r = client.pollAndProcess(cmd);
+  cpuNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+  uint32_t now = millis();
+  uint32_t wait = client.msUntilNextWork(now);
+  uint32_t reply = modem.msUntilOutput(now);
+  if (reply < wait) wait = reply;
+  if (maxWaitMs < wait) wait = maxWaitMs;
+  hostAdvance(wait ? wait : 1);
+  return r;
+}
+
+int ClientRig::runUntilResult(IrrigationCommand& cmd, uint32_t maxMs) {
+  uint32_t start = millis();
+  while (millis() - start < maxMs) {
+    int r = step(cmd);
+    if (r == 0 || r == -1 || r == -4) return r;
+  }
+  return -2;
+}
+
+void ClientRig::settle(uint32_t maxMs) {
+  IrrigationCommand cmd;
+  uint32_t start = millis();
+  do {
+    step(cmd);
+  } while (!(client.isIdle() && modemJobs.size() == 0 && !client.hasNewResponse()) &&
+           millis() - start < maxMs);
+}
+
+void ClientRig::runFor(uint32_t ms) {
+  IrrigationCommand cmd;
+  uint32_t start = millis();
+  while (millis() - start < ms) step(cmd, ms - (millis() - start));
+}
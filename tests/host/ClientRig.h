@@ -0,0 +1,33 @@
+#ifndef HOST_CLIENT_RIG_H
+#define HOST_CLIENT_RIG_H
+
+#include "Sim900.h"
+#include "Irrigation.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+
+// A Sim900Client of its own (not the sketch's) wired to an emulated modem
+// and server, for tests that look at pollAndProcess() results directly.
+struct ClientRig {
+  ModemEmulator modem;
+  SiteServer site;
+  Sim900Client client;
+  uint64_t cpuNs;   // host time spent inside loop()/pollAndProcess()
+
+  ClientRig();
+  // Empties the shared job queue, starts the client and runs the modem
+  // setup sequence; nothing has been polled yet
+  void begin();
+  // One pass, then jump the clock to the next reply or deadline, by at
+  // most maxWaitMs
+  int step(IrrigationCommand& cmd, uint32_t maxWaitMs = 0xFFFFFFFFUL);
+  // Steps until pollAndProcess() returns a command (0), a parse failure
+  // (-1) or "unchanged" (-4); -2 if maxMs pass first
+  int runUntilResult(IrrigationCommand& cmd, uint32_t maxMs = 3600000UL);
+  // Steps until the client is idle with nothing queued
+  void settle(uint32_t maxMs = 60000UL);
+  // Steps for exactly ms of virtual time
+  void runFor(uint32_t ms);
+};
+
+#endif
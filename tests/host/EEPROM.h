@@ -0,0 +1,31 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+// 4 KB of EEPROM (ATmega2560) in RAM, erased to 0xFF
+class EEPROMClass {
+public:
+  EEPROMClass();
+  uint8_t read(int addr) const { return bytes[addr]; }
+  void write(int addr, uint8_t v) { bytes[addr] = v; }
+  void update(int addr, uint8_t v) { bytes[addr] = v; }
+  uint16_t length() const { return sizeof(bytes); }
+  template <typename T> T& get(int addr, T& t) const {
+    memcpy(&t, bytes + addr, sizeof(T));
+    return t;
+  }
+  template <typename T> const T& put(int addr, const T& t) {
+    memcpy(bytes + addr, &t, sizeof(T));
+    return t;
+  }
+
+  void clear(); // host only: back to erased
+
+private:
+  uint8_t bytes[4096];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
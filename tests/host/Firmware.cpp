@@ -0,0 +1,26 @@
+#include "Firmware.h"
+
+static void onePass() {
+  uint32_t before = millis();
+  loop();
+  if (millis() == before) hostAdvance(1);
+}
+
+uint32_t hostRunFor(uint32_t ms) {
+  uint32_t start = millis();
+  uint32_t passes = 0;
+  while (millis() - start < ms) {
+    onePass();
+    passes++;
+  }
+  return passes;
+}
+
+bool hostRunUntil(const std::function<bool()>& done, uint32_t maxMs) {
+  uint32_t start = millis();
+  while (!done()) {
+    if (millis() - start >= maxMs) return false;
+    onePass();
+  }
+  return true;
+}
@@ -0,0 +1,34 @@
+#ifndef HOST_FIRMWARE_H
+#define HOST_FIRMWARE_H
+
+// The sketch (arduino_2560_irrigation_proj.ino) is built into every host
+// binary. Scenario tests call its setup()/loop() and inspect its globals.
+
+#include <functional>
+#include "Sim900.h"
+#include "Irrigation.h"
+#include "ModemTrace.h"
+#include "Schedule.h"
+#include "PeerLink.h"
+#include "PowerManager.h"
+#include "FlowMeter.h"
+
+extern ModemTrace modemTrace;
+extern Sim900Client sim900Client;
+extern IrrigationManager irrigation;
+extern ScheduleEngine schedule;
+extern PeerLink peerLink;
+extern PowerManager power;
+extern FlowMeter flowMeter;
+
+void setup();
+void loop();
+
+// Run loop() until millis() has moved ms forward. A pass that does not
+// sleep still costs 1 ms so a busy loop cannot stall the virtual clock.
+// Returns the number of passes.
+uint32_t hostRunFor(uint32_t ms);
+// Run loop() until done() holds or maxMs elapse; true if done() held
+bool hostRunUntil(const std::function<bool()>& done, uint32_t maxMs);
+
+#endif
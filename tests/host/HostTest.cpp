@@ -0,0 +1,47 @@
+#include "HostTest.h"
+#include <vector>
+
+namespace {
+  struct Entry {
+    const char* name;
+    HostTestFn fn;
+  };
+
+  std::vector<Entry>& registry() {
+    static std::vector<Entry> tests;
+    return tests;
+  }
+
+  bool g_failed = false;
+}
+
+HostTestCase::HostTestCase(const char* name, HostTestFn fn) {
+  Entry e = { name, fn };
+  registry().push_back(e);
+}
+
+bool hostCheckFailed(const char* file, int line, const char* expr, const std::string& detail) {
+  printf("  FAIL %s:%d: %s", file, line, expr);
+  if (!detail.empty()) printf("  (%s)", detail.c_str());
+  printf("\n");
+  g_failed = true;
+  return true;
+}
+
+std::string hostDescribe(long long v) { return std::to_string(v); }
+std::string hostDescribe(unsigned long long v) { return std::to_string(v); }
+std::string hostDescribe(const std::string& v) { return "\"" + v + "\""; }
+std::string hostDescribe(const char* v) { return v ? "\"" + std::string(v) + "\"" : "NULL"; }
+std::string hostDescribe(const String& v) { return "\"" + v.str() + "\""; }
+
+int main() {
+  int failures = 0;
+  for (size_t i = 0; i < registry().size(); i++) {
+    g_failed = false;
+    printf("%s\n", registry()[i].name);
+    registry()[i].fn();
+    if (g_failed) failures++;
+  }
+  printf("%d/%d passed\n", (int)registry().size() - failures, (int)registry().size());
+  return failures ? 1 : 0;
+}
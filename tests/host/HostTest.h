@@ -0,0 +1,59 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string>
+
+// Tiny test runner: TEST(name) { ... CHECK(...); } and HostTest.cpp's main()
+// runs them in file order. A failed CHECK reports and ends that test.
+
+typedef void (*HostTestFn)();
+
+struct HostTestCase {
+  HostTestCase(const char* name, HostTestFn fn);
+};
+
+bool hostCheckFailed(const char* file, int line, const char* expr, const std::string& detail);
+std::string hostDescribe(long long v);
+std::string hostDescribe(unsigned long long v);
+std::string hostDescribe(const std::string& v);
+std::string hostDescribe(const char* v);
+std::string hostDescribe(const String& v);
+template <typename T> std::string hostDescribe(T* v) { return hostDescribe((unsigned long long)(size_t)v); }
+inline std::string hostDescribe(bool v) { return v ? "true" : "false"; }
+inline std::string hostDescribe(int v) { return hostDescribe((long long)v); }
+inline std::string hostDescribe(long v) { return hostDescribe((long long)v); }
+inline std::string hostDescribe(unsigned int v) { return hostDescribe((unsigned long long)v); }
+inline std::string hostDescribe(unsigned long v) { return hostDescribe((unsigned long long)v); }
+inline std::string hostDescribe(unsigned char v) { return hostDescribe((unsigned long long)v); }
+inline std::string hostDescribe(unsigned short v) { return hostDescribe((unsigned long long)v); }
+
+#define TEST(name)                                                   \
+  static void name();                                                \
+  static HostTestCase name##_case(#name, name);                      \
+  static void name()
+
+#define CHECK(cond)                                                                  \
+  do {                                                                               \
+    if (!(cond) && hostCheckFailed(__FILE__, __LINE__, #cond, std::string())) return; \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                               \
+  do {                                                                               \
+    const auto& hostA_ = (a);                                                        \
+    const auto& hostB_ = (b);                                                        \
+    if (!(hostA_ == hostB_) &&                                                       \
+        hostCheckFailed(__FILE__, __LINE__, #a " == " #b,                            \
+                        hostDescribe(hostA_) + " vs " + hostDescribe(hostB_))) return; \
+  } while (0)
+
+// Measurements worth keeping in the log (latency, bytes, cycles)
+#define REPORT(...)                     \
+  do {                                  \
+    printf("    ");                     \
+    printf(__VA_ARGS__);                \
+    printf("\n");                       \
+  } while (0)
+
+#endif
@@ -0,0 +1,195 @@
+#include "ModemEmulator.h"
+#include <stdio.h>
+#include <time.h>
+
+ModemEmulator::ModemEmulator()
+  : bearerUp(true),
+    replyMs(20),
+    httpMs(400),
+    rtcBase(0),
+    dtrPin(-1),
+    bytesFromBoard(0),
+    bytesToBoard(0),
+    httpBodyBytes(0),
+    linesWhileAsleep(0),
+    injecting(false),
+    slowClock(false) {
+  setRtc(26, 10, 18, 6, 0, 0);
+}
+
+void ModemEmulator::setRtc(int yy, int mo, int dd, int hh, int mi, int ss) {
+  struct tm t = {};
+  t.tm_year = 100 + yy;
+  t.tm_mon = mo - 1;
+  t.tm_mday = dd;
+  t.tm_hour = hh;
+  t.tm_min = mi;
+  t.tm_sec = ss;
+  struct tm epoch2000 = {};
+  epoch2000.tm_year = 100;
+  epoch2000.tm_mday = 1;
+  rtcBase = (uint32_t)(timegm(&t) - timegm(&epoch2000)) - millis() / 1000UL;
+}
+
+std::string ModemEmulator::rtcString() const {
+  struct tm epoch2000 = {};
+  epoch2000.tm_year = 100;
+  epoch2000.tm_mday = 1;
+  time_t now = timegm(&epoch2000) + rtcBase + millis() / 1000UL;
+  struct tm t;
+  gmtime_r(&now, &t);
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%02d/%02d/%02d,%02d:%02d:%02d+08",
+           t.tm_year % 100, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+  return buf;
+}
+
+void ModemEmulator::reply(const std::string& reply, uint32_t afterMs) {
+  std::string text = reply;
+  if (injecting && !injectMarker.empty()) {
+    size_t p = text.find(injectMarker);
+    if (p != std::string::npos) {
+      text.insert(p + injectMarker.size(), injectText);
+      injecting = false;
+    }
+  }
+  uint32_t at = millis() + afterMs;
+  // Replies leave the modem in order; a URC timed for later does not hold
+  // them back
+  for (size_t i = out.size(); i > 0; i--) {
+    if (out[i - 1].timed) continue;
+    if ((int32_t)(out[i - 1].readyAt - at) > 0) at = out[i - 1].readyAt;
+    break;
+  }
+  queue(text, at, false);
+}
+
+void ModemEmulator::queue(const std::string& text, uint32_t at, bool timed) {
+  size_t pos = out.size();
+  while (pos > 0 && (int32_t)(out[pos - 1].readyAt - at) > 0) pos--;
+  std::deque<Pending> chars;
+  for (size_t i = 0; i < text.size(); i++) {
+    Pending p = { at, text[i], timed };
+    chars.push_back(p);
+  }
+  out.insert(out.begin() + pos, chars.begin(), chars.end());
+}
+
+void ModemEmulator::inject(const std::string& text, uint32_t afterMs) {
+  if (afterMs == 0) reply(text, 0);
+  else queue(text, millis() + afterMs, true);
+}
+
+void ModemEmulator::injectAfter(const std::string& commandPrefix, const std::string& text,
+                                const std::string& marker) {
+  injectPrefix = commandPrefix;
+  injectText = text;
+  injectMarker = marker;
+}
+
+void ModemEmulator::storeSms(int index, const std::string& sender, const std::string& text) {
+  sms.push_back(std::make_pair(index, std::make_pair(sender, text)));
+  char buf[32];
+  snprintf(buf, sizeof(buf), "\r\n+CMTI: \"SM\",%d\r\n", index);
+  inject(buf);
+}
+
+size_t ModemEmulator::countCommands(const std::string& prefix) const {
+  size_t n = 0;
+  for (size_t i = 0; i < commands.size(); i++) {
+    if (commands[i].compare(0, prefix.size(), prefix) == 0) n++;
+  }
+  return n;
+}
+
+uint32_t ModemEmulator::msUntilOutput(uint32_t now) const {
+  if (out.empty()) return 0xFFFFFFFFUL;
+  int32_t d = (int32_t)(out.front().readyAt - now);
+  return d > 0 ? (uint32_t)d : 0;
+}
+
+static bool startsWith(const std::string& s, const char* p) {
+  return s.compare(0, strlen(p), p) == 0;
+}
+
+void ModemEmulator::onCommand(const std::string& cmd) {
+  commands.push_back(cmd);
+  injecting = !injectPrefix.empty() && cmd.compare(0, injectPrefix.size(), injectPrefix) == 0;
+  if (injecting) injectPrefix.clear();
+  if (startsWith(cmd, "AT+HTTPPARA=\"URL\",\"")) {
+    size_t start = strlen("AT+HTTPPARA=\"URL\",\"");
+    size_t end = cmd.rfind('"');
+    urls.push_back(cmd.substr(start, end > start ? end - start : 0));
+    reply("\r\nOK\r\n", replyMs);
+  } else if (startsWith(cmd, "AT+HTTPACTION")) {
+    reply("\r\nOK\r\n", replyMs);
+    char buf[48];
+    if (bearerUp && !urls.empty()) {
+      body = server ? server(urls.back()) : std::string();
+      snprintf(buf, sizeof(buf), "\r\n+HTTPACTION: 0,200,%u\r\n", (unsigned)body.size());
+    } else {
+      body.clear();
+      snprintf(buf, sizeof(buf), "\r\n+HTTPACTION: 0,601,0\r\n");
+    }
+    reply(buf, httpMs);
+  } else if (startsWith(cmd, "AT+HTTPREAD")) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "\r\n+HTTPREAD: %u\r\n", (unsigned)body.size());
+    httpBodyBytes += body.size();
+    reply(buf + body + "\r\nOK\r\n", replyMs);
+  } else if (startsWith(cmd, "AT+CCLK?")) {
+    reply("\r\n+CCLK: \"" + rtcString() + "\"\r\n\r\nOK\r\n", replyMs);
+  } else if (startsWith(cmd, "AT+CMGR=")) {
+    int index = atoi(cmd.c_str() + strlen("AT+CMGR="));
+    std::string text = "\r\n";
+    for (size_t i = 0; i < sms.size(); i++) {
+      if (sms[i].first != index) continue;
+      text += "+CMGR: \"REC UNREAD\",\"" + sms[i].second.first + "\",\"\",\"26/10/18,06:00:00+08\"\r\n";
+      text += sms[i].second.second + "\r\n";
+    }
+    reply(text + "\r\nOK\r\n", replyMs);
+  } else if (startsWith(cmd, "AT+CSCLK=")) {
+    slowClock = cmd == "AT+CSCLK=1";
+    reply("\r\nOK\r\n", replyMs);
+  } else if (!bearerUp && (startsWith(cmd, "AT+CGATT=1") || startsWith(cmd, "AT+SAPBR=1,1"))) {
+    reply("\r\nERROR\r\n", replyMs);
+  } else {
+    reply("\r\nOK\r\n", replyMs);
+  }
+  if (injecting) {
+    injecting = false;
+    reply(injectText, 0);
+  }
+}
+
+int ModemEmulator::available() {
+  size_t n = 0;
+  while (n < out.size() && (int32_t)(millis() - out[n].readyAt) >= 0) n++;
+  return (int)n;
+}
+
+int ModemEmulator::read() {
+  if (!available()) return -1;
+  char c = out.front().c;
+  out.pop_front();
+  bytesToBoard++;
+  return (uint8_t)c;
+}
+
+int ModemEmulator::peek() {
+  return available() ? (uint8_t)out.front().c : -1;
+}
+
+size_t ModemEmulator::write(uint8_t b) {
+  bytesFromBoard++;
+  if (b == '\r' || b == '\n') {
+    // In slow-clock mode the UART only listens while DTR is held low
+    bool asleep = slowClock && dtrPin >= 0 && hostPinLevel((uint8_t)dtrPin) == HIGH;
+    if (!line.empty() && asleep) linesWhileAsleep++;
+    else if (!line.empty()) onCommand(line);
+    line.clear();
+  } else {
+    line += (char)b;
+  }
+  return 1;
+}
@@ -0,0 +1,78 @@
+#ifndef HOST_MODEM_EMULATOR_H
+#define HOST_MODEM_EMULATOR_H
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+// SIM900 stand-in on the host. Answers the AT commands Sim900Client sends,
+// serves HTTP GETs from a mock server callback and can inject unsolicited
+// result codes at any point, including in the middle of a transaction.
+// Replies become readable after a configurable delay on the virtual clock.
+class ModemEmulator : public Stream {
+public:
+  typedef std::function<std::string(const std::string& url)> Server;
+
+  ModemEmulator();
+
+  Server server;                 // GET url -> response body
+  bool bearerUp;                 // false: attach/bearer commands fail
+  uint32_t replyMs;              // command -> "OK"
+  uint32_t httpMs;               // AT+HTTPACTION -> +HTTPACTION URC
+  uint32_t rtcBase;              // RTC at millis() == 0, seconds since 2000-01-01
+  int dtrPin;                    // board pin on the modem's DTR, -1 if not wired
+
+  // Queue text from the modem at millis() + afterMs
+  void inject(const std::string& text, uint32_t afterMs = 0);
+  // Queue text with the reply to the next command starting with prefix:
+  // after the whole reply, or right after the first occurrence of marker
+  // in it (e.g. in the middle of an HTTPREAD body)
+  void injectAfter(const std::string& commandPrefix, const std::string& text,
+                   const std::string& marker = std::string());
+  void storeSms(int index, const std::string& sender, const std::string& text);
+  void setRtc(int yy, int mo, int dd, int hh, int mi, int ss);
+
+  uint32_t msUntilOutput(uint32_t now) const; // 0xFFFFFFFF if nothing queued
+
+  // What the board sent
+  std::vector<std::string> commands; // every command line
+  std::vector<std::string> urls;     // every GET
+  uint32_t bytesFromBoard;
+  uint32_t bytesToBoard;
+  uint32_t httpBodyBytes;
+  uint32_t linesWhileAsleep;     // sent in slow-clock mode with DTR high: lost
+  size_t countCommands(const std::string& prefix) const;
+
+  // Stream
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t b);
+  using Print::write;
+
+private:
+  struct Pending {
+    uint32_t readyAt;
+    char c;
+    bool timed;            // injected for a later time, not a reply
+  };
+
+  void onCommand(const std::string& cmd);
+  void reply(const std::string& text, uint32_t afterMs);
+  void queue(const std::string& text, uint32_t at, bool timed); // in readyAt order
+  std::string rtcString() const;
+
+  std::deque<Pending> out;
+  std::string line;
+  std::string body;
+  std::string injectPrefix;
+  std::string injectText;
+  std::string injectMarker;
+  bool injecting;          // replies of the current command take the injection
+  bool slowClock;          // AT+CSCLK=1 seen
+  std::vector<std::pair<int, std::pair<std::string, std::string> > > sms;
+};
+
+#endif
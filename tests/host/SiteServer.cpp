@@ -0,0 +1,42 @@
+#include "SiteServer.h"
+#include <stdlib.h>
+#include <string.h>
+
+std::string SiteServer::param(const std::string& url, const char* name) {
+  std::string key = std::string(name) + "=";
+  size_t q = url.find('?');
+  if (q == std::string::npos) return std::string();
+  size_t p = q + 1;
+  while (p < url.size()) {
+    size_t end = url.find('&', p);
+    if (end == std::string::npos) end = url.size();
+    if (url.compare(p, key.size(), key) == 0) return url.substr(p + key.size(), end - p - key.size());
+    p = end + 1;
+  }
+  return std::string();
+}
+
+std::string SiteServer::operator()(const std::string& url) {
+  if (url.find("leggiirrigazione.php") != std::string::npos) {
+    polls.push_back(url);
+    return onPoll ? onPoll(url) : pollBody;
+  }
+  if (url.find("leggiprogrammi.php") != std::string::npos) return scheduleBody;
+  if (url.find("irrigazione.php") != std::string::npos) {
+    Update u;
+    u.id = atol(param(url, "id").c_str());
+    u.status = atoi(param(url, "s").c_str());
+    u.minutes = atoi(param(url, "m").c_str());
+    u.url = url;
+    updates.push_back(u);
+    return "OK";
+  }
+  return std::string();
+}
+
+int SiteServer::lastStatus(long id) const {
+  for (size_t i = updates.size(); i > 0; i--) {
+    if (updates[i - 1].id == id) return updates[i - 1].status;
+  }
+  return -1;
+}
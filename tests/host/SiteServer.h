@@ -0,0 +1,32 @@
+#ifndef HOST_SITE_SERVER_H
+#define HOST_SITE_SERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Stand-in for the irrigation web server behind ModemEmulator::server.
+// Poll and schedule replies come from callbacks (or fixed bodies); status
+// updates are parsed and recorded.
+class SiteServer {
+public:
+  struct Update {
+    long id;
+    int status;
+    int minutes;
+    std::string url;
+  };
+
+  std::string pollBody;                       // used when onPoll is empty
+  std::function<std::string(const std::string& url)> onPoll;
+  std::string scheduleBody;
+  std::vector<Update> updates;
+  std::vector<std::string> polls;             // every poll URL
+
+  std::string operator()(const std::string& url);
+
+  int lastStatus(long id) const;              // -1 if never reported
+  static std::string param(const std::string& url, const char* name); // "" if absent
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef HOST_SOFTWARE_SERIAL_H
+#define HOST_SOFTWARE_SERIAL_H
+
+#include <Arduino.h>
+
+// Every SoftwareSerial talks to the stream the test attached, normally an
+// emulated SIM900 or a trace replay
+void hostAttachModem(Stream* modem);
+Stream* hostModem();
+
+class SoftwareSerial : public Stream {
+public:
+  SoftwareSerial(uint8_t, uint8_t) {}
+  void begin(long) {}
+  int available() { return hostModem() ? hostModem()->available() : 0; }
+  int read() { return hostModem() ? hostModem()->read() : -1; }
+  int peek() { return hostModem() ? hostModem()->peek() : -1; }
+  size_t write(uint8_t b) { return hostModem() ? hostModem()->write(b) : 1; }
+  using Print::write;
+};
+
+#endif
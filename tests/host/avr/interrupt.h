@@ -0,0 +1,7 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+// An ISR is a plain function on the host; tests call it directly
+#define ISR(vector) extern "C" void vector(void)
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define WDIE 6
+
+extern uint8_t MCUSR;
+extern uint8_t WDTCSR;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <Arduino.h>
+
+#define SLEEP_MODE_IDLE 0
+
+inline void set_sleep_mode(uint8_t) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+// Idle sleep ends at the next timer0 tick at the latest
+inline void sleep_cpu() { hostAdvance(1); }
+
+#endif
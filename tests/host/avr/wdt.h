@@ -0,0 +1,18 @@
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#include <stdint.h>
+
+#define WDTO_4S 8
+
+void wdt_enable(uint8_t timeout);
+void wdt_disable();
+void wdt_reset();
+
+// Host only: how the firmware fed the watchdog
+uint32_t hostWdtFeeds();
+uint32_t hostWdtLastFeedMs();
+uint32_t hostWdtLongestGapMs(); // longest time between two feeds while armed
+void hostWdtResetStats();
+
+#endif
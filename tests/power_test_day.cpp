@@ -0,0 +1,100 @@
+// A simulated day of the sketch on a low-power board (modem DTR wired),
+// built twice: with LOW_POWER_IDLE and without. The energy estimate is
+// recomputed from PowerManager's awake/sleep time and the supply currents
+// in Config.h. The "timeline:" lines (poll times, poll -> relay and push ->
+// relay latency) must come out identical in both builds; `make check`
+// compares them.
+
+#include "HostTest.h"
+#include "Firmware.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+#include <vector>
+
+namespace {
+  ModemEmulator modem;
+  SiteServer site;
+  std::vector<uint32_t> polledAt;
+  uint32_t bootMs;
+  uint32_t startServedAt;
+
+  const char* IDLE_BODY = "";
+  const char* START_BODY = "ID=400;Z=1,3;T=5;M=5;S=0";
+  const char* STOP_BODY = "ID=400;Z=1,3;T=5;M=4;S=8";
+  const char* CLIP_ALLOWED = "\r\nRING\r\n\r\n+CLIP: \"+393331234567\",145,\"\",0,\"\",0\r\n";
+
+  std::string body = IDLE_BODY;
+
+  std::string serve(const std::string&) {
+    polledAt.push_back(millis() - bootMs);
+    if (body == START_BODY && startServedAt == 0) startServedAt = millis();
+    return body;
+  }
+
+  uint8_t zone1Pin() { return (uint8_t)getZonePin(1); }
+  bool zone1Open() { return hostPinLevel(zone1Pin()) == LOW; }
+}
+
+TEST(one_idle_day_energy) {
+  modem.dtrPin = MODEM_DTR_PIN;
+  modem.server = std::ref(site);
+  site.onPoll = serve;
+  site.scheduleBody = "V=1\n";
+  hostAttachModem(&modem);
+  bootMs = millis();
+  setup();
+  hostRunFor(86400000UL);
+
+  // mAh/day from the awake/sleep split, as a board with a meter would see it
+  double covered = power.coveredMs();
+  double slept = power.sleptMs();
+  double busy = power.modemBusyTime();
+  double mcuUa = ((covered - slept) * MCU_ACTIVE_UA + slept * MCU_IDLE_UA) / covered;
+  double modemUa = (busy * MODEM_ACTIVE_UA + (covered - busy) * MODEM_SLEEP_UA) / covered;
+  double mAhPerDay = (mcuUa + modemUa) * 24.0 / 1000.0;
+  double alwaysOn = (MCU_ACTIVE_UA + MODEM_ACTIVE_UA) * 24.0 / 1000.0;
+  REPORT("MCU asleep %.1f%%, modem busy %.2f%%: %.0f mAh/day (%.0f never sleeping)",
+         100.0 * slept / covered, 100.0 * busy / covered, mAhPerDay, alwaysOn);
+  // The sleep in progress is accounted when it ends
+  CHECK(covered >= 86400000.0 - LOW_POWER_MAX_IDLE_MS);
+  CHECK(mAhPerDay - power.mAhPerDay() < 1.0 && power.mAhPerDay() - mAhPerDay < 1.0);
+  if (LOW_POWER_IDLE) {
+    CHECK(slept / covered > 0.99);
+    CHECK(mAhPerDay < alwaysOn / 2);
+  } else {
+    CHECK_EQ(power.sleptMs(), 0UL);
+  }
+
+  // The modem slept in slow clock and every command found it awake
+  CHECK_EQ(modem.countCommands("AT+CSCLK=1"), 1U);
+  CHECK_EQ(modem.linesWhileAsleep, 0UL);
+  CHECK(busy / covered < 0.05);
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < polledAt.size(); i++) sum += polledAt[i];
+  REPORT("timeline: %u polls in the day, poll time sum %llu ms",
+         (unsigned)polledAt.size(), (unsigned long long)sum);
+  CHECK(polledAt.size() >= 86400000UL / POLL_IDLE_MAX_INTERVAL_PUSH_MS);
+}
+
+TEST(poll_to_relay_latency) {
+  body = START_BODY;
+  CHECK(hostRunUntil(zone1Open, POLL_IDLE_MAX_INTERVAL_PUSH_MS + 60000UL));
+  uint32_t latency = hostPinChangedAt(zone1Pin()) - startServedAt;
+  REPORT("timeline: poll served at %u ms, zone 1 open %u ms later",
+         (unsigned)(startServedAt - bootMs), (unsigned)latency);
+  CHECK(latency < 2000UL);
+}
+
+TEST(push_to_relay_latency) {
+  // Rung at the same time in both builds, 30 s into the run
+  body = STOP_BODY;
+  uint32_t rang = startServedAt + 30000UL;
+  modem.inject(CLIP_ALLOWED, rang - millis());
+  CHECK(hostRunUntil([] { return !zone1Open(); }, POLL_INTERVAL_MS));
+  uint32_t latency = hostPinChangedAt(zone1Pin()) - rang;
+  REPORT("timeline: call at %u ms, zone 1 closed %u ms later",
+         (unsigned)(rang - bootMs), (unsigned)latency);
+  CHECK(latency < 5000UL);
+  CHECK_EQ(modem.linesWhileAsleep, 0UL);
+}
@@ -0,0 +1,101 @@
+// Push wake-up (PUSH_WAKE_NUMBERS set at build time): a call or SMS from a
+// listed number makes the board poll at once, wherever the URC lands.
+
+#include "HostTest.h"
+#include "ClientRig.h"
+#include <vector>
+
+namespace {
+  const char* BODY = "ID=210;Z=1,3;T=1;M=1;S=1"; // S=1: SLAVE1 ignores it
+  const char* CLIP_ALLOWED = "\r\nRING\r\n\r\n+CLIP: \"+393331234567\",145,\"\",0,\"\",0\r\n";
+  const char* CLIP_OTHER = "\r\nRING\r\n\r\n+CLIP: \"+393330000000\",145,\"\",0,\"\",0\r\n";
+
+  // Serves body and notes when each poll reached the server
+  void serve(ClientRig& rig, std::vector<uint32_t>& polledAt, const std::string& body) {
+    rig.site.onPoll = [&polledAt, body](const std::string&) {
+      polledAt.push_back(millis());
+      return body;
+    };
+  }
+}
+
+TEST(caller_id_and_sms_notifications_are_set_up) {
+  ClientRig rig;
+  rig.begin();
+  CHECK_EQ(rig.modem.countCommands("AT+CLIP=1"), 1U);
+  CHECK_EQ(rig.modem.countCommands("AT+CMGF=1"), 1U);
+  CHECK_EQ(rig.modem.countCommands("AT+CNMI"), 1U);
+}
+
+TEST(call_from_listed_number_polls_at_once) {
+  ClientRig rig;
+  std::vector<uint32_t> polledAt;
+  serve(rig, polledAt, BODY);
+  rig.begin();
+  rig.runFor(90000); // two polls; the next regular one is at 180 s
+  CHECK_EQ(polledAt.size(), 2U);
+  uint32_t rang = millis();
+  rig.modem.inject(CLIP_ALLOWED);
+  rig.runFor(10000);
+  CHECK_EQ(polledAt.size(), 3U);
+  CHECK(polledAt.back() - rang < 5000UL);
+  CHECK_EQ(rig.modem.countCommands("ATH"), 1U);
+}
+
+TEST(call_from_other_number_is_hung_up_only) {
+  ClientRig rig;
+  std::vector<uint32_t> polledAt;
+  serve(rig, polledAt, BODY);
+  rig.begin();
+  rig.runFor(90000);
+  rig.modem.inject(CLIP_OTHER);
+  rig.runFor(10000);
+  CHECK_EQ(polledAt.size(), 2U);
+  CHECK_EQ(rig.modem.countCommands("ATH"), 1U);
+}
+
+TEST(caller_id_inside_http_read_is_stripped_and_wakes) {
+  ClientRig rig;
+  std::vector<uint32_t> polledAt;
+  serve(rig, polledAt, "ID=212;Z=1,3;T=1;M=1;S=1");
+  rig.begin();
+  rig.modem.injectAfter("AT+HTTPREAD", "+CLIP: \"+393331234567\",145,\"\",0,\"\",0\r\n",
+                        "+HTTPREAD: 24\r\n");
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 212L);
+  CHECK_EQ((int)cmd.numZones, 2);
+  rig.runFor(10000);
+  CHECK_EQ(polledAt.size(), 2U);
+  CHECK_EQ(rig.modem.countCommands("ATH"), 1U);
+}
+
+TEST(sms_text_repeating_body_text_removes_only_itself) {
+  ClientRig rig;
+  rig.site.pollBody = "ID=213;Z=1,3;T=1;M=1;S=1";
+  rig.begin();
+  // The SMS text also occurs in the body; only the pushed line may go
+  rig.modem.injectAfter("AT+HTTPREAD",
+                        "+CMT: \"+393331234567\",\"\",\"26/10/18,06:00:00+08\"\r\nT=1\r\n",
+                        "S=1\r\n");
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(rig.site.polls.size(), 1U);
+  CHECK_EQ(cmd.id, 213L);
+  CHECK_EQ((int)cmd.totalMinutes, 1);
+  CHECK_EQ((int)cmd.numZones, 2);
+}
+
+TEST(stored_sms_from_listed_number_polls_at_once) {
+  ClientRig rig;
+  std::vector<uint32_t> polledAt;
+  serve(rig, polledAt, BODY);
+  rig.begin();
+  rig.runFor(90000);
+  uint32_t sent = millis();
+  rig.modem.storeSms(3, "+393331234567", "wake");
+  rig.runFor(10000);
+  CHECK_EQ(rig.modem.countCommands("AT+CMGR=3"), 1U);
+  CHECK_EQ(polledAt.size(), 3U);
+  CHECK(polledAt.back() - sent < 5000UL);
+}
@@ -0,0 +1,140 @@
+// IrrigationManager::pollUrgency() for the role this binary is built as:
+// fast polls while the board waits for a peer to move a command along
+// (and only for POLL_FAST_WINDOW_MS), at the end of a run and after a
+// dashboard STOP; the regular interval during a run; backoff otherwise.
+
+#include "HostTest.h"
+#include "Irrigation.h"
+#include "EepromStore.h"
+
+namespace {
+  Sim900Client modem;
+  long nextId = 8000;
+
+  // A command for zones 1 (SLAVE1), 5 (SLAVE1 pump) and/or 7 (SLAVE2)
+  IrrigationCommand command(long id, uint8_t status, bool z1, bool z5, bool z7) {
+    IrrigationCommand cmd;
+    cmd.valid = true;
+    cmd.id = id;
+    cmd.status = status;
+    cmd.totalMinutes = 10;
+    cmd.remainingMinutes = 10;
+    if (z1) cmd.zones[cmd.numZones++] = 1;
+    if (z5) cmd.zones[cmd.numZones++] = 5;
+    if (z7) cmd.zones[cmd.numZones++] = 7;
+    return cmd;
+  }
+
+  void drain() {
+    ModemJob job;
+    while (modemJobs.pop(millis(), job)) {}
+  }
+
+  // True if a start for id was reported since the previous drain
+  bool started(long id) {
+    bool any = false;
+    ModemJob job;
+    while (modemJobs.pop(millis(), job)) {
+      if (job.kind == JobStatus && job.id == id && job.status == ThisRole::kStartStatus) any = true;
+    }
+    return any;
+  }
+
+  void boot(IrrigationManager& board) {
+    EepromStore::clear();
+    drain();
+    board.begin();
+  }
+
+  // S=0 that this role has to wait on: MASTER for any run that needs its
+  // pump (no zone 5), SLAVE2 for one with its zones. SLAVE1 starts on S=0
+  // itself and never waits.
+  bool waitsOnStart(bool z1, bool z5, bool z7) {
+#if ROLE == ROLE_MASTER
+    return !z5;
+#elif ROLE == ROLE_SLAVE1
+    return false;
+#else
+    return z7;
+#endif
+  }
+}
+
+TEST(idle_board_backs_off) {
+  IrrigationManager board(modem);
+  boot(board);
+  CHECK_EQ(board.pollUrgency(), PollIdle);
+}
+
+TEST(waiting_status_polls_fast_for_a_while) {
+  for (uint8_t set = 0; set < 8; set++) {
+    bool z1 = (set & 1) != 0, z5 = (set & 2) != 0, z7 = (set & 4) != 0;
+    if (set == 0) continue;
+    IrrigationManager board(modem);
+    boot(board);
+    long id = nextId++;
+    board.onServerCommand(command(id, 0, z1, z5, z7));
+    if (started(id)) continue; // SLAVE1 started this one itself
+
+    PollUrgency want = waitsOnStart(z1, z5, z7) ? PollUrgent : PollIdle;
+    CHECK_EQ(board.pollUrgency(), want);
+    hostAdvance(POLL_FAST_WINDOW_MS - 1000UL);
+    CHECK_EQ(board.pollUrgency(), want);
+    // The peer never answered: back to the idle backoff
+    hostAdvance(1000UL);
+    CHECK_EQ(board.pollUrgency(), PollIdle);
+  }
+}
+
+TEST(other_idle_statuses_back_off) {
+  // Statuses past the start (or a finished run) leave nothing to wait for
+  for (uint8_t s = 1; s < STATUS_COUNT; s++) {
+    IrrigationManager board(modem);
+    boot(board);
+    IrrigationCommand cmd = command(nextId++, s, false, false, true);
+#if ROLE == ROLE_SLAVE2
+    if (s == 1) continue; // SLAVE2's start
+#endif
+#if ROLE == ROLE_MASTER
+    if (s == 1 || s == 2) continue; // MASTER's start
+#endif
+    board.onServerCommand(cmd);
+    drain();
+    CHECK_EQ(board.pollUrgency(), PollIdle);
+  }
+}
+
+TEST(run_polls_regularly_then_fast_near_the_end) {
+  IrrigationManager board(modem);
+  boot(board);
+  IrrigationCommand cmd = command(nextId++, 0xFF, true, false, true);
+  cmd.remainingMinutes = 3;
+  CHECK(board.startLocalProgram(cmd));
+  drain();
+  CHECK_EQ(board.pollUrgency(), PollActive);
+  // One tick per second down to POLL_NEAR_END_S left
+  for (uint32_t s = 0; s < 180 - POLL_NEAR_END_S; s++) {
+    CHECK_EQ(board.pollUrgency(), PollActive);
+    hostAdvance(1000UL);
+    board.tick();
+  }
+  drain();
+  CHECK_EQ(board.pollUrgency(), PollUrgent);
+}
+
+TEST(dashboard_stop_polls_fast_until_acknowledged) {
+  // S=7 ends MASTER's run at once; the slaves keep running until the
+  // S=8 that follows, which they have to pick up quickly
+  IrrigationManager board(modem);
+  boot(board);
+  long id = nextId++;
+  CHECK(board.startLocalProgram(command(id, 0xFF, true, false, true)));
+  drain();
+  board.onServerCommand(command(id, 7, true, false, true));
+  drain();
+#if ROLE == ROLE_MASTER
+  CHECK_EQ(board.pollUrgency(), PollIdle);
+#else
+  CHECK_EQ(board.pollUrgency(), PollUrgent);
+#endif
+}
@@ -0,0 +1,162 @@
+// Every (server status, idle/running, zone list) a board can meet, for the
+// role this binary is built as. The expected reaction is written out below
+// from the status map in TESTING.md, not read back from RolePolicy.h, so a
+// wrong table row fails here even when the table is self-consistent.
+
+#include <string>
+#include "HostTest.h"
+#include "Irrigation.h"
+#include "EepromStore.h"
+
+namespace {
+  Sim900Client modem;
+  long nextId = 7000;
+
+  // Zones 1 (SLAVE1), 5 (SLAVE1 pump) and 7 (SLAVE2) in every combination
+  const uint8_t CANDIDATES[] = { 1, 5, 7 };
+  const uint8_t ZONE_SETS = 1 << sizeof(CANDIDATES);
+
+  bool wiredHere(uint8_t z) {
+#if ROLE == ROLE_MASTER
+    return false;                                   // pump only
+#elif ROLE == ROLE_SLAVE1
+    return z == 1 || z == 5;
+#else
+    return z == 7;
+#endif
+  }
+
+  // Status the board must report, -1 for none
+  int expectedReport(uint8_t s, bool running, bool local, bool zone5) {
+#if ROLE == ROLE_MASTER
+    if (!running && (s == 1 || s == 2) && !zone5) return 3;
+    if (s == 7) return 8;
+#elif ROLE == ROLE_SLAVE1
+    if (!running && s == 0 && local) return 1;
+    if (running && s == 4) return 5;
+    if (running && s == 8) return 9;
+#else
+    if (!running && s == 1 && local) return 2;
+    if (running && (s == 4 || s == 5)) return 6;
+    if (running && (s == 8 || s == 9)) return 10;
+#endif
+    return -1;
+  }
+
+  // A schedule program starts on an idle board that has work in it
+  bool expectedLocalStart(bool running, bool local, bool zone5) {
+#if ROLE == ROLE_MASTER
+    return !running && !zone5;
+#else
+    return !running && local;
+#endif
+  }
+
+  IrrigationCommand command(long id, uint8_t status, uint8_t set) {
+    IrrigationCommand cmd;
+    cmd.valid = true;
+    cmd.id = id;
+    cmd.status = status;
+    cmd.totalMinutes = 10;
+    cmd.remainingMinutes = 10;
+    for (uint8_t i = 0; i < sizeof(CANDIDATES); i++) {
+      if (set & (1 << i)) cmd.zones[cmd.numZones++] = CANDIDATES[i];
+    }
+    return cmd;
+  }
+
+  // A run every role accepts: SLAVE1 and SLAVE2 zones, no zone 5
+  IrrigationCommand runnable(long id) {
+    return command(id, 0, (1 << 0) | (1 << 2));
+  }
+
+  void drain() {
+    ModemJob job;
+    while (modemJobs.pop(millis(), job)) {}
+  }
+
+  // Last transition reported for id since the previous drain, -1 for none
+  int reported(long id) {
+    int last = -1;
+    ModemJob job;
+    while (modemJobs.pop(millis(), job)) {
+      if (job.kind == JobStatus && job.id == id) last = job.status;
+    }
+    return last;
+  }
+
+  bool open(uint8_t z) {
+    return hostPinLevel((uint8_t)getZonePin(z)) == LOW;
+  }
+
+  // The outputs the command addresses on this board, all on or all off
+  bool outputsAre(const IrrigationCommand& cmd, bool on) {
+    for (uint8_t i = 0; i < cmd.numZones; i++) {
+      if (wiredHere(cmd.zones[i]) && open(cmd.zones[i]) != on) return false;
+    }
+    return !ThisRole::kDrivesPump || (hostPinLevel(PUMP_PIN) == LOW) == on;
+  }
+
+  std::string describe(uint8_t s, bool running, uint8_t set, int report, bool runningAfter) {
+    std::string z;
+    for (uint8_t i = 0; i < sizeof(CANDIDATES); i++) {
+      if (set & (1 << i)) z += (z.empty() ? "" : ",") + std::to_string(CANDIDATES[i]);
+    }
+    return "S=" + std::to_string(s) + (running ? " running" : " idle") + " Z=" + z +
+           " -> report " + std::to_string(report) + (runningAfter ? ", running" : ", idle");
+  }
+
+  // Fresh board, idle or in the middle of run id
+  void boot(IrrigationManager& board, bool running, long id) {
+    EepromStore::clear();
+    drain();
+    board.begin();
+    if (running) board.startLocalProgram(runnable(id));
+    drain();
+  }
+}
+
+TEST(server_status_table_is_exhaustive) {
+  for (uint8_t s = 0; s < STATUS_COUNT; s++) {
+    for (uint8_t running = 0; running < 2; running++) {
+      for (uint8_t set = 0; set < ZONE_SETS; set++) {
+        long id = nextId++;
+        IrrigationManager board(modem);
+        boot(board, running, id);
+        IrrigationCommand cmd = command(id, s, set);
+        bool local = false;
+        for (uint8_t i = 0; i < cmd.numZones; i++) local = local || wiredHere(cmd.zones[i]);
+        bool zone5 = (set & (1 << 1)) != 0;
+
+        int want = expectedReport(s, running, local, zone5);
+        bool wantRunning = want < 0 ? running != 0 : want <= 3;   // S=1..3 start a run
+        board.onServerCommand(cmd);
+        int got = reported(id);
+        if (got >= 0) CHECK(outputsAre(cmd, got == (int)ThisRole::kStartStatus));
+        // Only an idle board takes a new schedule run
+        bool gotRunning = !board.startLocalProgram(runnable(nextId++));
+        CHECK_EQ(describe(s, running, set, got, gotRunning),
+                 describe(s, running, set, want, wantRunning));
+      }
+    }
+  }
+}
+
+TEST(local_start_follows_the_start_row) {
+  for (uint8_t running = 0; running < 2; running++) {
+    for (uint8_t set = 0; set < ZONE_SETS; set++) {
+      long id = nextId++;
+      IrrigationManager board(modem);
+      boot(board, running, id);
+      IrrigationCommand cmd = command(nextId++, 0xFF, set);
+      bool local = false;
+      for (uint8_t i = 0; i < cmd.numZones; i++) local = local || wiredHere(cmd.zones[i]);
+      bool zone5 = (set & (1 << 1)) != 0;
+
+      bool want = expectedLocalStart(running, local, zone5);
+      CHECK_EQ(board.startLocalProgram(cmd), want);
+      CHECK_EQ(reported(cmd.id), want ? (int)ThisRole::kStartStatus : -1);
+      if (want) CHECK(outputsAre(cmd, true));
+    }
+  }
+}
@@ -0,0 +1,174 @@
+// Compact poll format: decoding, fallback to text after a corrupt reply and
+// the cost of both formats.
+
+#include <chrono>
+#include "HostTest.h"
+#include "ClientRig.h"
+#include "Firmware.h"
+
+namespace {
+  const char* TEXT = "ID=199;Z=1,3,10;T=1;M=1;S=1";
+  const char* COMPACT = "B:AccAAAAFAgEBAaMF"; // TEXT, from the encoder in TESTING.md
+  const char* CORRUPT = "B:AccAAAAFAgEBAaMG"; // last CRC character changed
+  const char* COMPACT_V2 = "B:AscAAAAFAgEBAZABBABB6A"; // TEXT + L=400, schedule version 4
+
+  bool asksCompact(const std::string& url) {
+    return SiteServer::param(url, "f") == "b";
+  }
+}
+
+TEST(reference_record_decodes) {
+  IrrigationCommand c = ParserServer::parsePayload(String(COMPACT));
+  CHECK(c.valid);
+  CHECK_EQ(c.id, 199L);
+  CHECK_EQ(c.numZones, 3);
+  CHECK_EQ(c.zones[0], 1);
+  CHECK_EQ(c.zones[1], 3);
+  CHECK_EQ(c.zones[2], 10);
+  CHECK_EQ(c.totalMinutes, 1);
+  CHECK_EQ(c.remainingMinutes, 1);
+  CHECK_EQ(c.status, 1);
+
+  IrrigationCommand t = ParserServer::parsePayload(String(TEXT));
+  CHECK(t.valid);
+  CHECK_EQ(t.id, c.id);
+  CHECK_EQ(t.numZones, c.numZones);
+  CHECK_EQ(t.status, c.status);
+  CHECK_EQ(ParserServer::announcedScheduleVersion(String(COMPACT)), -1L);
+
+  IrrigationCommand v2 = ParserServer::parsePayload(String(COMPACT_V2));
+  CHECK(v2.valid);
+  CHECK_EQ(v2.id, 199L);
+  CHECK_EQ(v2.numZones, 3);
+  CHECK_EQ(v2.status, 1);
+  CHECK_EQ(v2.targetLiters, 400);
+  CHECK_EQ(ParserServer::announcedScheduleVersion(String(COMPACT_V2)), 4L);
+  // A V= line still wins
+  CHECK_EQ(ParserServer::announcedScheduleVersion(String("V=7\n") + COMPACT_V2), 7L);
+}
+
+TEST(corrupt_record_is_rejected) {
+  CHECK(!ParserServer::parsePayload(String(CORRUPT)).valid);
+  CHECK(!ParserServer::parsePayload(String("B:AccAAAAFAgEB")).valid);    // truncated
+  CHECK(!ParserServer::parsePayload(String("B:AccAAAAFAgEBAa!F")).valid); // not base64url
+  IrrigationCommand batch[POLL_MAX_RECORDS];
+  bool corrupt = false;
+  CHECK_EQ(ParserServer::parseBatch(String(CORRUPT), batch, POLL_MAX_RECORDS, corrupt), 0);
+  CHECK(corrupt);
+}
+
+TEST(corrupt_reply_falls_back_to_text_with_backoff) {
+  ClientRig rig;
+  bool corruptMode = true;
+  std::vector<uint32_t> at;
+  rig.site.onPoll = [&](const std::string& url) {
+    at.push_back(millis());
+    if (!asksCompact(url)) return std::string("ID=300;Z=1;T=1;M=1;S=1");
+    return std::string(corruptMode ? CORRUPT : "B:ASwBAAABAAEBATJl");
+  };
+  rig.begin();
+  IrrigationCommand cmd;
+  // 1 + 1 + 2 + 4 + 8 polls: each corrupt compact reply is followed by
+  // twice as many text polls as the last one
+  for (int i = 0; i < 20; i++) rig.runUntilResult(cmd);
+  std::string pattern;
+  for (size_t i = 0; i < rig.site.polls.size(); i++) pattern += asksCompact(rig.site.polls[i]) ? 'B' : 't';
+  CHECK_EQ(pattern.substr(0, 20), std::string("BtBttBttttBttttttttB"));
+  // The first text poll does not wait for the poll interval
+  CHECK(at[1] - at[0] < 5000);
+
+  // A good compact reply resets the backoff to a single text poll
+  corruptMode = false;
+  size_t from = rig.site.polls.size();
+  do {
+    rig.runUntilResult(cmd);
+  } while (!asksCompact(rig.site.polls.back()));
+  corruptMode = true;
+  for (int i = 0; i < 4; i++) rig.runUntilResult(cmd);
+  pattern.clear();
+  for (size_t i = from; i < rig.site.polls.size(); i++) pattern += asksCompact(rig.site.polls[i]) ? 'B' : 't';
+  // Without the reset this would be "Bttt" (32 text polls after a 16)
+  CHECK_EQ(pattern.substr(pattern.size() - 4), std::string("BtBt"));
+  rig.settle();
+}
+
+TEST(format_cost) {
+  // Modem bytes per poll, compact-capable server vs text-only server
+  uint32_t bytesPerPoll[2];
+  for (int compact = 0; compact < 2; compact++) {
+    ClientRig rig;
+    rig.site.onPoll = [compact](const std::string& url) {
+      return std::string(compact && asksCompact(url) ? COMPACT : TEXT);
+    };
+    rig.begin();
+    IrrigationCommand cmd;
+    rig.runUntilResult(cmd);
+    uint32_t before = rig.modem.bytesFromBoard + rig.modem.bytesToBoard;
+    size_t polls = rig.site.polls.size();
+    for (int i = 0; i < 10; i++) rig.runUntilResult(cmd);
+    bytesPerPoll[compact] = (rig.modem.bytesFromBoard + rig.modem.bytesToBoard - before) /
+                            (uint32_t)(rig.site.polls.size() - polls);
+    rig.settle();
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  const int N = 20000;
+  String text(TEXT);
+  String compact(COMPACT);
+  long sum = 0;
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < N; i++) sum += ParserServer::parsePayload(text).id;
+  Clock::time_point t1 = Clock::now();
+  for (int i = 0; i < N; i++) sum += ParserServer::parsePayload(compact).id;
+  Clock::time_point t2 = Clock::now();
+  CHECK_EQ(sum, 2L * N * 199);
+  double textNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)N;
+  double compactNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / (double)N;
+
+  REPORT("text:    %u-byte body, %u modem bytes per unchanged poll, %.0f ns host decode",
+         (unsigned)strlen(TEXT), bytesPerPoll[0], textNs);
+  REPORT("compact: %u-byte body, %u modem bytes per unchanged poll, %.0f ns host decode",
+         (unsigned)strlen(COMPACT), bytesPerPoll[1], compactNs);
+  CHECK(bytesPerPoll[1] < bytesPerPoll[0]);
+}
+
+namespace {
+  ModemEmulator sketchModem;
+  SiteServer sketchSite;
+
+  size_t scheduleGets() {
+    size_t n = 0;
+    for (size_t i = 0; i < sketchModem.urls.size(); i++) {
+      if (sketchModem.urls[i].find("leggiprogrammi.php") != std::string::npos) n++;
+    }
+    return n;
+  }
+}
+
+TEST(compact_reply_triggers_schedule_refresh) {
+  // Same irrigation, without and with the schedule version (S=1 is not for SLAVE1)
+  const char* withoutVersion = "B:AS0BAAAFAB4eAQh7";
+  const char* version4 = "B:Ai0BAAAFAB4eAQAABACstA";
+  std::string reply = withoutVersion;
+  sketchModem.server = std::ref(sketchSite);
+  sketchSite.onPoll = [&](const std::string& url) {
+    return asksCompact(url) ? reply : std::string("ID=301;Z=1,3;T=30;M=30;S=1");
+  };
+  sketchSite.scheduleBody = "V=3\n";
+  hostAttachModem(&sketchModem);
+  setup();
+  const uint32_t window = POLL_IDLE_MAX_INTERVAL_MS + SCHEDULE_RETRY_MS;
+  hostRunFor(window);
+  size_t gets = scheduleGets();
+  CHECK_EQ(gets, 1u);
+  hostRunFor(window);
+  CHECK_EQ(scheduleGets(), gets);
+
+  // Version 4 arrives in the compact record alone, no V= line
+  sketchSite.scheduleBody = "V=4\nP=12;D=1;H=06:00;L=2;Z=1,3\n";
+  reply = version4;
+  CHECK(hostRunUntil([&] { return scheduleGets() > gets; }, window));
+  CHECK_EQ(sim900Client.serverScheduleVersion(), 4L);
+  hostRunFor(window);
+  CHECK_EQ(scheduleGets(), gets + 1);
+}
@@ -0,0 +1,102 @@
+// Conditional polling: the board sends &h=<FNV-1a of the last body> and
+// skips parsing when the server answers "unchanged" (empty body).
+
+#include "HostTest.h"
+#include "ClientRig.h"
+
+namespace {
+  const char* BODY = "ID=199;Z=1,3,10;T=1;M=1;S=1"; // S=1: SLAVE1 ignores it
+
+  std::string hex(uint32_t v) {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%x", v);
+    return buf;
+  }
+
+  // Server that honours h: empty reply when the client already has the body
+  void conditionalServer(ClientRig& rig, const std::string& body) {
+    rig.site.onPoll = [body](const std::string& url) {
+      std::string h = SiteServer::param(url, "h");
+      return h == hex(ParserServer::bodyHash(String(body))) ? std::string() : body;
+    };
+  }
+}
+
+TEST(body_hash_matches_reference_vector) {
+  // Value printed by the python one-liner in TESTING.md
+  CHECK_EQ(ParserServer::bodyHash(String(BODY)), 0xde75174cUL);
+  CHECK_EQ(ParserServer::bodyHash(String("")), 2166136261UL);
+}
+
+TEST(second_poll_sends_hash_and_empty_reply_is_unchanged) {
+  ClientRig rig;
+  conditionalServer(rig, BODY);
+  rig.begin();
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 199L);
+  CHECK_EQ(SiteServer::param(rig.site.polls.back(), "h"), std::string());
+
+  CHECK_EQ(rig.runUntilResult(cmd), -4);
+  CHECK_EQ(SiteServer::param(rig.site.polls.back(), "h"), std::string("de75174c"));
+  CHECK_EQ(rig.modem.countCommands("AT+HTTPREAD"), rig.site.polls.size());
+}
+
+TEST(server_ignoring_hash_is_deduplicated_locally) {
+  ClientRig rig;
+  rig.site.pollBody = "ID=200;Z=1,3,10;T=1;M=1;S=1";
+  rig.begin();
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(rig.runUntilResult(cmd), -4);
+  CHECK_EQ(rig.runUntilResult(cmd), -4);
+}
+
+TEST(local_transition_drops_hash) {
+  ClientRig rig;
+  conditionalServer(rig, "ID=201;Z=1,3,10;T=1;M=1;S=1");
+  rig.begin();
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(rig.runUntilResult(cmd), -4);
+
+  // The board reports a new status for 201: the same body must be
+  // evaluated again, so the next poll goes out without h and is applied
+  ParserServer::sendStatusUpdate(201, 8, 0);
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 201L);
+  CHECK_EQ(SiteServer::param(rig.site.polls.back(), "h"), std::string());
+  rig.settle();
+}
+
+TEST(idle_hour_cost) {
+  // Same idle hour against both servers: modem bytes and client CPU
+  uint32_t bytes[2];
+  uint32_t polls[2];
+  double usPerPoll[2];
+  for (int conditional = 0; conditional < 2; conditional++) {
+    ClientRig rig;
+    if (conditional) conditionalServer(rig, BODY);
+    else rig.site.pollBody = BODY;
+    rig.begin();
+    uint32_t before = rig.modem.bytesFromBoard + rig.modem.bytesToBoard;
+    rig.cpuNs = 0;
+    IrrigationCommand cmd;
+    uint32_t start = millis();
+    size_t firstPoll = rig.site.polls.size();
+    while (millis() - start < 3600000UL) rig.step(cmd);
+    bytes[conditional] = rig.modem.bytesFromBoard + rig.modem.bytesToBoard - before;
+    polls[conditional] = (uint32_t)(rig.site.polls.size() - firstPoll);
+    usPerPoll[conditional] = polls[conditional] ? rig.cpuNs / 1000.0 / polls[conditional] : 0;
+    rig.settle();
+  }
+  REPORT("idle hour, server ignores h: %u polls, %u modem bytes, %.1f us host CPU per poll",
+         polls[0], bytes[0], usPerPoll[0]);
+  REPORT("idle hour, server honours h: %u polls, %u modem bytes, %.1f us host CPU per poll",
+         polls[1], bytes[1], usPerPoll[1]);
+  // Same backoff either way, so the bytes compare poll for poll: the
+  // unchanged body the server no longer sends outweighs "&h=xxxxxxxx"
+  CHECK(polls[1] > 0);
+  CHECK_EQ(polls[1], polls[0]);
+  CHECK(bytes[1] < bytes[0]);
+}
@@ -0,0 +1,103 @@
+// Flow meter: fixed-point pulse to volume conversion and the no-flow /
+// over-flow window thresholds, driven through the pulse interrupt.
+
+#include "HostTest.h"
+#include "FlowMeter.h"
+
+namespace {
+  void pulses(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) hostFireInterrupt(FLOW_METER_PIN);
+  }
+
+  // Past the start grace, with the first check window just opened
+  void armed(FlowMeter& meter) {
+    meter.begin();
+    meter.startRun(0);
+    hostAdvance(FLOW_START_GRACE_MS);
+    meter.update(millis());
+  }
+
+  FlowFault afterWindow(uint32_t n, uint32_t windowMs = FLOW_CHECK_WINDOW_MS) {
+    FlowMeter meter;
+    armed(meter);
+    pulses(n);
+    hostAdvance(windowMs);
+    meter.update(millis());
+    return meter.fault();
+  }
+}
+
+TEST(pulses_to_ml_is_exact_floor) {
+  CHECK_EQ(FlowMeter::pulsesToMl(0), 0UL);
+  CHECK_EQ(FlowMeter::pulsesToMl(1), 2UL);          // 2.22 mL
+  CHECK_EQ(FlowMeter::pulsesToMl(225), 500UL);
+  CHECK_EQ(FlowMeter::pulsesToMl(450), 1000UL);
+  // Against 64-bit math, up to the documented 42M-pulse limit
+  for (uint32_t p = 0; p < 42000000UL; p = p * 3 + 7) {
+    uint64_t expect = (uint64_t)p * 100000ULL / FLOW_PULSES_PER_LITER_X100;
+    CHECK_EQ((uint64_t)FlowMeter::pulsesToMl(p), expect);
+  }
+  CHECK_EQ(FlowMeter::pulsesToMl(40000000UL), 88888888UL);
+}
+
+TEST(window_thresholds_follow_k_factor) {
+  // 2 L/min and 60 L/min at 450 pulses per liter, over 10 s
+  CHECK_EQ((int)afterWindow(150), (int)FlowOk);
+  CHECK_EQ((int)afterWindow(149), (int)FlowNone);
+  CHECK_EQ((int)afterWindow(4500), (int)FlowOk);
+  CHECK_EQ((int)afterWindow(4501), (int)FlowExcess);
+}
+
+TEST(late_update_scales_the_window) {
+  // Twice the window and twice the pulses is the same rate
+  CHECK_EQ((int)afterWindow(300, 2 * FLOW_CHECK_WINDOW_MS), (int)FlowOk);
+  CHECK_EQ((int)afterWindow(290, 2 * FLOW_CHECK_WINDOW_MS), (int)FlowNone);
+}
+
+TEST(no_check_during_start_grace) {
+  FlowMeter meter;
+  meter.begin();
+  meter.startRun(0);
+  for (uint32_t t = 0; t < FLOW_START_GRACE_MS; t += 1000) {
+    hostAdvance(1000);
+    meter.update(millis());
+  }
+  CHECK_EQ((int)meter.fault(), (int)FlowOk);
+  // First full window with a dry well
+  hostAdvance(FLOW_CHECK_WINDOW_MS);
+  meter.update(millis());
+  CHECK_EQ((int)meter.fault(), (int)FlowNone);
+}
+
+TEST(fault_latches_for_the_run) {
+  FlowMeter meter;
+  armed(meter);
+  hostAdvance(FLOW_CHECK_WINDOW_MS);
+  meter.update(millis());
+  CHECK_EQ((int)meter.fault(), (int)FlowNone);
+  pulses(1000);
+  hostAdvance(FLOW_CHECK_WINDOW_MS);
+  meter.update(millis());
+  CHECK_EQ((int)meter.fault(), (int)FlowNone);
+  meter.startRun(0);
+  CHECK_EQ((int)meter.fault(), (int)FlowOk);
+}
+
+TEST(run_volume_resumes_and_freezes) {
+  FlowMeter meter;
+  meter.begin();
+  meter.startRun(2500);            // delivered before a reset
+  pulses(450);
+  CHECK_EQ(meter.runMilliliters(), 3500UL);
+  CHECK_EQ(meter.runLiters(), (uint16_t)3);
+  meter.stopRun();
+  pulses(450);                     // pipe draining after the stop
+  CHECK_EQ(meter.runMilliliters(), 3500UL);
+}
+
+TEST(window_across_millis_wrap) {
+  hostSetMillis(0xFFFFFFFFUL - FLOW_START_GRACE_MS - 2000);
+  CHECK_EQ((int)afterWindow(150), (int)FlowOk);
+  hostSetMillis(0xFFFFFFFFUL - FLOW_START_GRACE_MS - 2000);
+  CHECK_EQ((int)afterWindow(100), (int)FlowNone);
+}
@@ -0,0 +1,154 @@
+// Modem job queue: polls keep running under a flood of status traffic, a
+// full queue still takes new transitions, and deadlines survive the
+// millis() wrap.
+
+#include "HostTest.h"
+#include "ClientRig.h"
+#include <vector>
+
+namespace {
+  ModemJob statusJob(long id, uint8_t status, uint32_t now) {
+    ModemJob job = ModemJob();
+    job.kind = JobStatus;
+    job.priority = PrioHigh;
+    job.enqueuedAt = now;
+    job.id = id;
+    job.status = status;
+    return job;
+  }
+
+  ModemJob pollJob(uint32_t now) {
+    ModemJob job = ModemJob();
+    job.kind = JobPoll;
+    job.priority = PrioNormal;
+    job.enqueuedAt = now;
+    job.deadline = now + POLL_MAX_DELAY_MS;
+    job.hasDeadline = true;
+    return job;
+  }
+}
+
+// First, so the queue statistics cover this scenario only
+TEST(polls_keep_their_deadline_under_status_flood) {
+  ClientRig rig;
+  std::vector<uint32_t> polledAt;
+  rig.site.onPoll = [&polledAt](const std::string&) {
+    polledAt.push_back(millis());
+    return std::string("ID=205;Z=1,3;T=1;M=1;S=1");
+  };
+  rig.begin();
+  // Four irrigations each change status twice a second for ten minutes,
+  // far more than one modem can send
+  uint8_t sent[4] = { 0, 0, 0, 0 };
+  uint32_t start = millis();
+  for (uint32_t n = 0; millis() - start < 600000UL; n++) {
+    for (uint8_t k = 0; k < 4; k++) {
+      sent[k] = (uint8_t)(1 + (n + k) % 9);
+      ParserServer::sendStatusUpdate(1000 + k, sent[k], 5);
+    }
+    rig.runFor(500);
+  }
+  rig.runFor(60000);
+  rig.settle();
+
+  const ModemJobStats& polls = modemJobs.stats(JobPoll);
+  REPORT("polls=%u maxQueueDelay=%ums statusSent=%u coalesced=%u dropped=%u",
+         (unsigned)polls.count, (unsigned)polls.maxDelayMs, (unsigned)rig.site.updates.size(),
+         (unsigned)modemJobs.coalesced(), (unsigned)modemJobs.dropped());
+  CHECK(polledAt.size() >= 5);
+  // Dispatch waits for the deadline plus at most one transaction in flight
+  CHECK(polls.maxDelayMs <= POLL_MAX_DELAY_MS + 5000UL);
+  CHECK(modemJobs.coalesced() > 0);
+  // Merged transitions lose intermediate steps, never the latest one
+  for (uint8_t k = 0; k < 4; k++) CHECK_EQ(rig.site.lastStatus(1000 + k), (int)sent[k]);
+}
+
+TEST(full_queue_merges_transition_for_same_id) {
+  ModemJobQueue q;
+  uint32_t now = 1000;
+  for (long id = 1; id < MODEM_JOB_QUEUE_SIZE; id++) CHECK(q.push(statusJob(id, 1, now)));
+  CHECK_EQ(q.size(), (uint8_t)(MODEM_JOB_QUEUE_SIZE - 1));
+  // A new irrigation has nowhere to go, a known one updates its slot
+  CHECK(!q.push(statusJob(50, 1, now + 10)));
+  CHECK(q.push(statusJob(3, 8, now + 10)));
+  CHECK_EQ(q.size(), (uint8_t)(MODEM_JOB_QUEUE_SIZE - 1));
+  CHECK_EQ(q.coalesced(), 1UL);
+
+  ModemJob job;
+  for (long id = 1; id < MODEM_JOB_QUEUE_SIZE; id++) {
+    CHECK(q.pop(now + 20, job));
+    CHECK_EQ(job.id, id);                       // order of first arrival
+    CHECK_EQ((int)job.status, id == 3 ? 8 : 1);
+    CHECK_EQ(job.enqueuedAt, now);
+  }
+}
+
+TEST(full_queue_folds_another_irrigation_to_make_room) {
+  ModemJobQueue q;
+  q.push(statusJob(1, 1, 0));
+  q.push(statusJob(1, 3, 0));
+  for (long id = 2; id < MODEM_JOB_QUEUE_SIZE - 1; id++) q.push(statusJob(id, 1, 0));
+  CHECK_EQ(q.size(), (uint8_t)(MODEM_JOB_QUEUE_SIZE - 1));
+  CHECK(q.push(statusJob(50, 1, 0)));
+  ModemJob job;
+  CHECK(q.pop(10, job));
+  CHECK_EQ(job.id, 1L);
+  CHECK_EQ((int)job.status, 3);
+  for (long id = 2; id < MODEM_JOB_QUEUE_SIZE - 1; id++) {
+    CHECK(q.pop(10, job));
+    CHECK_EQ(job.id, id);
+  }
+  CHECK(q.pop(10, job));
+  CHECK_EQ(job.id, 50L);
+  CHECK_EQ(q.dropped(), 0UL);
+}
+
+TEST(merged_transition_keeps_flow_fault) {
+  ModemJobQueue q;
+  for (long id = 1; id < MODEM_JOB_QUEUE_SIZE; id++) {
+    ModemJob j = statusJob(id, 8, 0);
+    if (id == 2) j.fault = 1;
+    q.push(j);
+  }
+  CHECK(q.push(statusJob(2, 9, 5)));
+  ModemJob job;
+  q.pop(10, job);
+  q.pop(10, job);
+  CHECK_EQ(job.id, 2L);
+  CHECK_EQ((int)job.status, 9);
+  CHECK_EQ((int)job.fault, 1);
+}
+
+TEST(poll_has_a_slot_in_full_queue) {
+  ModemJobQueue q;
+  for (long id = 1; id < 20; id++) q.push(statusJob(id, 1, 0));
+  CHECK_EQ(q.size(), (uint8_t)(MODEM_JOB_QUEUE_SIZE - 1));
+  CHECK(q.push(pollJob(0)));
+  CHECK_EQ(q.size(), (uint8_t)MODEM_JOB_QUEUE_SIZE);
+  CHECK(q.has(JobPoll));
+}
+
+TEST(expired_poll_deadline_outranks_status) {
+  ModemJobQueue q;
+  q.push(pollJob(0));
+  q.push(statusJob(1, 1, 0));
+  q.push(statusJob(2, 1, 0));
+  ModemJob job;
+  CHECK(q.pop(1000, job));
+  CHECK_EQ((int)job.kind, (int)JobStatus);
+  CHECK(q.pop(POLL_MAX_DELAY_MS, job));
+  CHECK_EQ((int)job.kind, (int)JobPoll);
+}
+
+TEST(deadline_across_millis_wrap) {
+  ModemJobQueue q;
+  uint32_t now = 0xFFFFFFFFUL - 5000;  // deadline lands after the wrap
+  q.push(pollJob(now));
+  q.push(statusJob(1, 1, now));
+  ModemJob job;
+  CHECK(q.pop(now + 1000, job));
+  CHECK_EQ((int)job.kind, (int)JobStatus);
+  q.push(statusJob(2, 1, now + 1000));
+  CHECK(q.pop(now + POLL_MAX_DELAY_MS, job));
+  CHECK_EQ((int)job.kind, (int)JobPoll);
+}
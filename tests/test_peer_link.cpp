@@ -0,0 +1,203 @@
+// Peer link between three boards on an in-memory RS-485 bus: delivery
+// latency, loss recovery, ack attribution and a peer reboot.
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include "HostTest.h"
+#include "PeerLink.h"
+
+namespace {
+  // 11 bytes at PEER_LINK_BAUD (10 bits per byte), rounded up
+  const uint32_t FRAME_MS = (11UL * 10UL * 1000UL + PEER_LINK_BAUD - 1) / PEER_LINK_BAUD;
+
+  class Bus;
+
+  // One board's UART on the bus. A frame written here reaches every other
+  // port FRAME_MS later unless the bus drops it.
+  class BusPort : public Stream {
+  public:
+    BusPort(Bus& b, uint8_t r) : bus(b), role(r) {}
+    int available() {
+      return !rx.empty() && (int32_t)(millis() - rx.front().first) >= 0 ? 1 : 0;
+    }
+    int read() {
+      if (!available()) return -1;
+      uint8_t c = rx.front().second;
+      rx.pop_front();
+      return c;
+    }
+    int peek() { return available() ? rx.front().second : -1; }
+    size_t write(uint8_t b);
+    using Print::write;
+
+    std::deque<std::pair<uint32_t, uint8_t> > rx;
+    std::vector<uint8_t> tx;
+
+  private:
+    Bus& bus;
+    uint8_t role;
+  };
+
+  class Bus {
+  public:
+    // drop(from, to, type): true loses that copy of the frame
+    std::function<bool(uint8_t, uint8_t, uint8_t)> drop;
+    BusPort* ports[4];
+    uint32_t frames;
+
+    Bus() : frames(0) {
+      for (uint8_t i = 0; i < 4; i++) ports[i] = NULL;
+    }
+
+    void send(uint8_t from, const std::vector<uint8_t>& f) {
+      frames++;
+      for (uint8_t to = ROLE_MASTER; to <= ROLE_SLAVE2; to++) {
+        if (to == from || !ports[to]) continue;
+        if (drop && drop(from, to, f[3])) continue;
+        uint32_t at = millis() + FRAME_MS;
+        for (size_t i = 0; i < f.size(); i++) ports[to]->rx.push_back(std::make_pair(at, f[i]));
+      }
+    }
+  };
+
+  size_t BusPort::write(uint8_t b) {
+    tx.push_back(b);
+    if (tx.size() == 11) {
+      bus.send(role, tx);
+      tx.clear();
+    }
+    return 1;
+  }
+
+  struct Board {
+    PeerLink link;
+    BusPort port;
+    std::vector<PeerStatus> got;
+
+    Board(Bus& bus, uint8_t role) : link(role), port(bus, role) {
+      bus.ports[role] = &port;
+      link.begin(port);
+    }
+    void step() {
+      link.loop();
+      PeerStatus ps;
+      while (link.receive(ps)) {
+        got.push_back(ps);
+        link.loop();
+      }
+    }
+  };
+
+  struct Site {
+    Bus bus;
+    Board master;
+    Board slave1;
+    Board slave2;
+    Site() : master(bus, ROLE_MASTER), slave1(bus, ROLE_SLAVE1), slave2(bus, ROLE_SLAVE2) {}
+
+    void run(uint32_t ms) {
+      for (uint32_t t = 0; t < ms; t++) {
+        master.step();
+        slave1.step();
+        slave2.step();
+        hostAdvance(1);
+      }
+    }
+    // ms until every link has nothing left to send (all acks in)
+    uint32_t settle(uint32_t maxMs = 2000) {
+      uint32_t start = millis();
+      while (millis() - start < maxMs) {
+        run(1);
+        uint32_t now = millis();
+        if (master.link.msUntilNextEvent(now) == 0xFFFFFFFFUL &&
+            slave1.link.msUntilNextEvent(now) == 0xFFFFFFFFUL &&
+            slave2.link.msUntilNextEvent(now) == 0xFFFFFFFFUL) break;
+      }
+      return millis() - start;
+    }
+  };
+
+  size_t countStatus(const Board& b, uint8_t from, long id, uint8_t status) {
+    size_t n = 0;
+    for (size_t i = 0; i < b.got.size(); i++) {
+      if (b.got[i].from == from && b.got[i].id == id && b.got[i].status == status) n++;
+    }
+    return n;
+  }
+}
+
+TEST(status_reaches_both_peers_and_is_acked) {
+  Site site;
+  site.slave1.link.publish(401, 1, 10);
+  uint32_t start = millis();
+  while (site.master.got.empty() || site.slave2.got.empty()) site.run(1);
+  uint32_t delivered = millis() - start;
+  uint32_t acked = delivered + site.settle();
+  REPORT("delivered to both peers in %u ms, all acks in after %u ms (%u frames)",
+         delivered, acked, site.bus.frames);
+  CHECK_EQ(countStatus(site.master, ROLE_SLAVE1, 401, 1), 1u);
+  CHECK_EQ(countStatus(site.slave2, ROLE_SLAVE1, 401, 1), 1u);
+  CHECK_EQ(site.bus.frames, 3u); // one status, two acks, no retransmission
+  CHECK(acked < PEER_LINK_RETRY_MS);
+}
+
+TEST(lost_frames_are_retransmitted_and_delivered_once) {
+  Site site;
+  int lost = 0;
+  // The first two copies of the status to the MASTER and the first ack
+  // from SLAVE2 are lost
+  site.bus.drop = [&](uint8_t from, uint8_t to, uint8_t type) {
+    if (type == 'S' && to == ROLE_MASTER && lost < 2) return ++lost, true;
+    if (type == 'A' && from == ROLE_SLAVE2 && lost < 3) return ++lost, true;
+    return false;
+  };
+  site.slave1.link.publish(402, 1, 10);
+  uint32_t start = millis();
+  while (site.master.got.empty()) site.run(1);
+  uint32_t delivered = millis() - start;
+  uint32_t acked = delivered + site.settle();
+  REPORT("with 3 frames lost: MASTER got it after %u ms, all acks in after %u ms",
+         delivered, acked);
+  CHECK_EQ(countStatus(site.master, ROLE_SLAVE1, 402, 1), 1u);
+  CHECK_EQ(countStatus(site.slave2, ROLE_SLAVE1, 402, 1), 1u);
+  CHECK(acked < PEER_LINK_RETRY_MS * PEER_LINK_RETRIES);
+}
+
+TEST(ack_counts_only_for_the_status_it_names) {
+  Site site;
+  // SLAVE1 and SLAVE2 both publish their first status (seq 1). The MASTER
+  // misses SLAVE2's first copies, so its ack for seq 1 is SLAVE1's only.
+  int lost = 0;
+  site.bus.drop = [&](uint8_t from, uint8_t to, uint8_t type) {
+    return type == 'S' && from == ROLE_SLAVE2 && to == ROLE_MASTER && lost++ < 2;
+  };
+  site.slave1.link.publish(403, 1, 10);
+  site.slave2.link.publish(403, 2, 10);
+  site.settle();
+  CHECK_EQ(countStatus(site.master, ROLE_SLAVE1, 403, 1), 1u);
+  CHECK_EQ(countStatus(site.master, ROLE_SLAVE2, 403, 2), 1u);
+  CHECK_EQ(countStatus(site.slave1, ROLE_SLAVE2, 403, 2), 1u);
+  CHECK_EQ(countStatus(site.slave2, ROLE_SLAVE1, 403, 1), 1u);
+}
+
+TEST(rebooted_peer_is_not_taken_for_a_retransmission) {
+  Site site;
+  site.slave1.link.publish(404, 1, 10);
+  site.settle();
+  CHECK_EQ(countStatus(site.master, ROLE_SLAVE1, 404, 1), 1u);
+
+  // SLAVE1 restarts: a fresh link whose sequence starts over at 1
+  PeerLink rebooted(ROLE_SLAVE1);
+  rebooted.begin(site.slave1.port);
+  rebooted.publish(404, 5, 0);
+  for (int i = 0; i < 200; i++) {
+    rebooted.loop();
+    site.master.step();
+    site.slave2.step();
+    hostAdvance(1);
+  }
+  CHECK_EQ(countStatus(site.master, ROLE_SLAVE1, 404, 5), 1u);
+  CHECK_EQ(countStatus(site.slave2, ROLE_SLAVE1, 404, 5), 1u);
+  CHECK_EQ(rebooted.msUntilNextEvent(millis()), 0xFFFFFFFFUL);
+}
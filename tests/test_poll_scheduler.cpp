@@ -0,0 +1,131 @@
+// PollScheduler on its own: idle backoff, the hourly cap and requestImmediate,
+// with the clock started just short of the millis() wrap so every window
+// and interval crosses 0xFFFFFFFF. The per-role urgency that feeds it is in
+// role_test_poll_urgency.cpp.
+
+#include <vector>
+#include "HostTest.h"
+#include "PollScheduler.h"
+
+namespace {
+  const uint32_t HOUR_MS = 3600000UL;
+  const uint32_t NEAR_WRAP = 0xFFFFFFFFUL - 30000UL;
+
+  // millis() ms after NEAR_WRAP, wrapped like the board's
+  uint32_t after(uint32_t ms) { return NEAR_WRAP + ms; }
+
+  // Polls whenever due, in 1 s steps, for span ms from start; returns the
+  // times (relative to start) at which polls began
+  std::vector<uint32_t> pollFor(PollScheduler& p, uint32_t start, uint32_t span, bool changed) {
+    std::vector<uint32_t> at;
+    for (uint32_t t = 0; t < span; t += 1000) {
+      if (!p.due(start + t)) continue;
+      p.onPollStarted(start + t);
+      p.onPollResult(changed);
+      at.push_back(t);
+    }
+    return at;
+  }
+}
+
+TEST(first_poll_is_due_at_once) {
+  PollScheduler p;
+  CHECK(p.due(NEAR_WRAP));
+  CHECK_EQ(p.msUntilDue(NEAR_WRAP), 0UL);
+}
+
+TEST(interval_counts_across_the_wrap) {
+  PollScheduler p;
+  p.setUrgency(PollActive);
+  p.onPollStarted(NEAR_WRAP);
+  // 10 s before and 30 s after the wrap
+  CHECK_EQ(p.msUntilDue(after(20000UL)), POLL_INTERVAL_MS - 20000UL);
+  CHECK_EQ(p.msUntilDue(after(59999UL)), 1UL);
+  CHECK(!p.due(after(40000UL)));
+  CHECK(p.due(after(POLL_INTERVAL_MS)));
+  CHECK(p.due(after(POLL_INTERVAL_MS + 1UL)));
+}
+
+TEST(idle_backoff_doubles_up_to_the_ceiling) {
+  PollScheduler p;
+  std::vector<uint32_t> seen;
+  seen.push_back(p.interval());
+  for (int i = 0; i < 6; i++) {
+    p.onPollResult(false);
+    seen.push_back(p.interval());
+  }
+  const uint32_t want[] = { 60000UL, 120000UL, 240000UL, 480000UL, 900000UL, 900000UL, 900000UL };
+  CHECK_EQ(seen.size(), sizeof(want) / sizeof(want[0]));
+  for (size_t i = 0; i < seen.size(); i++) CHECK_EQ(seen[i], want[i]);
+  CHECK_EQ(seen.back(), POLL_IDLE_MAX_INTERVAL_MS);
+
+  // A changed reply starts the backoff over
+  p.onPollResult(true);
+  CHECK_EQ(p.interval(), POLL_INTERVAL_MS);
+}
+
+TEST(idle_polls_follow_the_backoff) {
+  PollScheduler p;
+  std::vector<uint32_t> at = pollFor(p, NEAR_WRAP, HOUR_MS, false);
+  std::vector<uint32_t> gaps;
+  for (size_t i = 1; i < at.size(); i++) gaps.push_back(at[i] - at[i - 1]);
+  // Each unchanged reply doubles the wait before the next poll
+  const uint32_t want[] = { 120000UL, 240000UL, 480000UL, 900000UL, 900000UL, 900000UL };
+  CHECK(gaps.size() >= sizeof(want) / sizeof(want[0]));
+  for (size_t i = 0; i < sizeof(want) / sizeof(want[0]); i++) CHECK_EQ(gaps[i], want[i]);
+}
+
+TEST(urgency_picks_the_interval) {
+  PollScheduler p;
+  p.onPollResult(false);
+  p.onPollResult(false);
+  CHECK_EQ(p.interval(), 240000UL);
+  p.setUrgency(PollActive);
+  CHECK_EQ(p.interval(), POLL_INTERVAL_MS);
+  p.setUrgency(PollUrgent);
+  CHECK_EQ(p.interval(), POLL_FAST_INTERVAL_MS);
+  // The idle backoff is kept while a run is going
+  p.setUrgency(PollIdle);
+  CHECK_EQ(p.interval(), 240000UL);
+}
+
+TEST(hourly_cap_holds_across_the_wrap) {
+  PollScheduler p;
+  p.setUrgency(PollUrgent);
+  // Fast polls would be 240 an hour; POLL_MAX_PER_HOUR stops them
+  std::vector<uint32_t> at = pollFor(p, NEAR_WRAP, 2 * HOUR_MS, true);
+  size_t firstHour = 0;
+  while (firstHour < at.size() && at[firstHour] < HOUR_MS) firstHour++;
+  REPORT("urgent polling: %u polls in the first hour, next at +%u s",
+         (unsigned)firstHour, (unsigned)(at[firstHour] / 1000));
+  CHECK_EQ(firstHour, (size_t)POLL_MAX_PER_HOUR);
+  CHECK_EQ(at[POLL_MAX_PER_HOUR - 1], (POLL_MAX_PER_HOUR - 1) * POLL_FAST_INTERVAL_MS);
+  // Held until the window that began with the first poll is over
+  CHECK_EQ(at[POLL_MAX_PER_HOUR], HOUR_MS);
+  CHECK_EQ(at.size(), 2 * (size_t)POLL_MAX_PER_HOUR);
+
+  // msUntilDue reports the rest of the window, not the fast interval
+  PollScheduler q;
+  q.setUrgency(PollUrgent);
+  uint32_t t = NEAR_WRAP;
+  for (uint16_t i = 0; i < POLL_MAX_PER_HOUR; i++, t += POLL_FAST_INTERVAL_MS) q.onPollStarted(t);
+  CHECK_EQ(q.msUntilDue(t), HOUR_MS - (uint32_t)POLL_MAX_PER_HOUR * POLL_FAST_INTERVAL_MS);
+  CHECK(!q.due(after(HOUR_MS - 1)));
+  CHECK(q.due(after(HOUR_MS)));
+}
+
+TEST(immediate_request_skips_the_interval_not_the_cap) {
+  PollScheduler p;
+  p.onPollStarted(NEAR_WRAP);
+  p.onPollResult(false);
+  CHECK(!p.due(after(1000UL)));
+  p.requestImmediate();
+  CHECK(p.due(after(1000UL)));
+  p.onPollStarted(after(1000UL));
+  CHECK(!p.due(after(2000UL))); // one poll per request
+
+  for (uint16_t i = 2; i < POLL_MAX_PER_HOUR; i++) p.onPollStarted(after(2000UL + i));
+  p.requestImmediate();
+  CHECK(!p.due(after(3000UL)));
+  CHECK_EQ(p.msUntilDue(after(3000UL)), HOUR_MS - 3000UL);
+}
@@ -0,0 +1,129 @@
+// Several pending irrigations in one poll body, on the booted sketch: the
+// first one that starts owns the board until it ends, then the next starts.
+// The parser and the applied-record check are also tested on their own.
+
+#include "HostTest.h"
+#include "Firmware.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+#include "ClientRig.h"
+
+namespace {
+  ModemEmulator modem;
+  SiteServer site;
+
+  bool zoneOpen(uint8_t z) {
+    return hostPinLevel((uint8_t)getZonePin(z)) == LOW;
+  }
+
+  // The server lists both records, each with the last status a board
+  // reported for it (pending until then)
+  std::string body(const std::string&) {
+    int s198 = site.lastStatus(198);
+    int s199 = site.lastStatus(199);
+    return "ID=198;Z=1;T=1;M=1;S=" + std::to_string(s198 < 0 ? 0 : s198) + "\n" +
+           "ID=199;Z=3;T=1;M=1;S=" + std::to_string(s199 < 0 ? 0 : s199);
+  }
+}
+
+TEST(second_pending_record_waits_for_the_first) {
+  modem.server = std::ref(site);
+  site.onPoll = body;
+  hostAttachModem(&modem);
+  setup();
+  CHECK(hostRunUntil([] { return site.lastStatus(198) >= 0; }, 120000UL));
+  hostRunFor(5000);
+  CHECK_EQ(site.lastStatus(198), (int)ThisRole::kStartStatus);
+  CHECK(zoneOpen(1));
+  CHECK(!zoneOpen(3));
+  CHECK_EQ(site.lastStatus(199), -1);
+
+  // Polls during the run keep listing 199 as pending
+  hostRunFor(40000);
+  CHECK(zoneOpen(1));
+  CHECK(!zoneOpen(3));
+  CHECK_EQ(site.lastStatus(199), -1);
+}
+
+TEST(next_record_starts_when_the_run_ends) {
+  CHECK(hostRunUntil([] { return site.lastStatus(198) == (int)ThisRole::kCompleteStatus; }, 120000UL));
+  CHECK(!zoneOpen(1));
+  // The next poll may be a full idle interval away
+  CHECK(hostRunUntil([] { return site.lastStatus(199) >= 0; }, POLL_IDLE_MAX_INTERVAL_MS + 60000UL));
+  hostRunFor(5000);
+  CHECK_EQ(site.lastStatus(199), (int)ThisRole::kStartStatus);
+  CHECK(zoneOpen(3));
+  CHECK(!zoneOpen(1));
+}
+
+TEST(start_then_stop_in_one_body_never_opens) {
+  // Both transitions of 200 happened while the board was out of reach:
+  // the later line wins, and a STOP for an idle board does nothing
+  CHECK(hostRunUntil([] { return site.lastStatus(199) == (int)ThisRole::kCompleteStatus; }, 120000UL));
+  site.onPoll = [](const std::string&) {
+    return std::string("ID=200;Z=1,3;T=5;M=5;S=0\nID=200;Z=1,3;T=5;M=4;S=8");
+  };
+  size_t polls = site.polls.size();
+  uint32_t zone1Changed = hostPinChangedAt((uint8_t)getZonePin(1));
+  CHECK(hostRunUntil([=] { return site.polls.size() > polls + 1; }, 2 * POLL_IDLE_MAX_INTERVAL_MS));
+  CHECK_EQ(hostPinChangedAt((uint8_t)getZonePin(1)), zone1Changed);
+  CHECK(!zoneOpen(1));
+  CHECK(!zoneOpen(3));
+  CHECK_EQ(site.lastStatus(200), -1);
+}
+
+TEST(later_line_for_an_id_supersedes_an_earlier_one) {
+  IrrigationCommand batch[POLL_MAX_RECORDS];
+  bool corrupt = false;
+  uint8_t n = ParserServer::parseBatch(String("ID=210;Z=1;T=5;M=5;S=0\n"
+                                              "ID=211;Z=3;T=5;M=5;S=0\n"
+                                              "ID=210;Z=1;T=5;M=3;S=4"),
+                                       batch, POLL_MAX_RECORDS, corrupt);
+  CHECK_EQ(n, 2);
+  CHECK_EQ(batch[0].id, 210L);
+  CHECK_EQ(batch[0].status, 4);
+  CHECK_EQ(batch[0].remainingMinutes, 3);
+  CHECK_EQ(batch[1].id, 211L);
+  CHECK(!corrupt);
+}
+
+TEST(overflow_keeps_the_oldest_pending) {
+  // Six irrigations, room for four: the lowest ids are applied now and
+  // the rest with a later poll, in id order either way
+  IrrigationCommand batch[POLL_MAX_RECORDS];
+  bool corrupt = false;
+  uint8_t n = ParserServer::parseBatch(String("ID=225;Z=1;T=1;M=1;S=0\n"
+                                              "ID=221;Z=1;T=1;M=1;S=0\n"
+                                              "ID=224;Z=1;T=1;M=1;S=0\n"
+                                              "ID=222;Z=1;T=1;M=1;S=0\n"
+                                              "ID=226;Z=1;T=1;M=1;S=0\n"
+                                              "ID=223;Z=1;T=1;M=1;S=0"),
+                                       batch, POLL_MAX_RECORDS, corrupt);
+  CHECK_EQ(n, POLL_MAX_RECORDS);
+  for (uint8_t i = 0; i < n; i++) CHECK_EQ(batch[i].id, 221L + i);
+}
+
+TEST(unchanged_record_is_not_applied_again) {
+  ClientRig rig;
+  std::string reply = "ID=230;Z=1;T=5;M=5;S=0\nID=231;Z=3;T=5;M=5;S=0";
+  rig.site.onPoll = [&](const std::string&) { return reply; };
+  rig.begin();
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 230L);
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 231L);
+
+  // Only 231 moved on: 230 is skipped, not handed out a second time
+  reply = "ID=230;Z=1;T=5;M=5;S=0\nID=231;Z=3;T=5;M=5;S=1";
+  size_t polls = rig.site.polls.size();
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(rig.site.polls.size(), polls + 1);
+  CHECK_EQ(cmd.id, 231L);
+  CHECK_EQ(cmd.status, 1);
+
+  // Nothing new in the next body either
+  reply = "ID=231;Z=3;T=5;M=5;S=1\nID=230;Z=1;T=5;M=5;S=0";
+  CHECK_EQ(rig.runUntilResult(cmd), -4);
+  rig.settle();
+}
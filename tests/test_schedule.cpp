@@ -0,0 +1,103 @@
+// Offline schedule on the booted sketch: download and clock retries, then a
+// weekly program started from the emulated modem's RTC. The tests after the
+// first share one sketch instance and run in file order.
+
+#include "HostTest.h"
+#include "Firmware.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+
+namespace {
+  ModemEmulator modem;
+  SiteServer site;
+
+  size_t scheduleGets() {
+    size_t n = 0;
+    for (size_t i = 0; i < modem.urls.size(); i++) {
+      if (modem.urls[i].find("leggiprogrammi.php") != std::string::npos) n++;
+    }
+    return n;
+  }
+
+  bool zoneOpen(uint8_t z) {
+    return hostPinLevel((uint8_t)getZonePin(z)) == LOW;
+  }
+
+  const long RUN_ID = LOCAL_RUN_ID_BASE + 12;
+}
+
+TEST(wall_clock_parses_modem_time) {
+  WallClock c;
+  CHECK(!c.parse("04/01/01,00:00:05+00")); // RTC never set
+  CHECK(!c.parse("26/13/18,06:00:30+08"));
+  CHECK(c.parse("\"26/10/18,06:00:30+08\"")); // a Sunday
+  CHECK_EQ(c.minuteOfWeek(millis()), 360);
+  CHECK_EQ(c.msToNextMinute(millis()), 30000UL);
+  CHECK_EQ(c.minuteOfWeek(millis() + 7UL * 86400000UL), 360); // wraps weekly
+}
+
+TEST(failed_download_and_unset_clock_are_retried) {
+  modem.server = std::ref(site);
+  hostAttachModem(&modem);
+  site.scheduleBody = "<html>503 Service Unavailable</html>";
+  modem.setRtc(4, 1, 1, 0, 0, 0); // SIM900 RTC before the network sets it
+  setup();
+  hostRunFor(30000);
+  CHECK_EQ(scheduleGets(), 1u);
+  CHECK_EQ(modem.countCommands("AT+CCLK?"), 1u);
+
+  // Neither was accepted: both are asked again at the short period, not
+  // after SCHEDULE_REFRESH_MS / CLOCK_SYNC_INTERVAL_MS
+  hostRunFor(SCHEDULE_RETRY_MS);
+  CHECK_EQ(scheduleGets(), 2u);
+  CHECK(modem.countCommands("AT+CCLK?") >= SCHEDULE_RETRY_MS / CLOCK_RETRY_MS);
+}
+
+TEST(accepted_download_stops_retrying) {
+  site.scheduleBody = "V=3\nP=12;D=1;H=06:00;L=2;Z=1,3\n"; // Sundays 06:00, 2 min
+  modem.setRtc(26, 10, 18, 5, 30, 0);
+  hostRunFor(SCHEDULE_RETRY_MS + CLOCK_RETRY_MS);
+  size_t gets = scheduleGets();
+  size_t clocks = modem.countCommands("AT+CCLK?");
+  CHECK_EQ(gets, 3u);
+  hostRunFor(15UL * 60000UL); // now about 05:51
+  CHECK_EQ(scheduleGets(), gets);
+  CHECK_EQ(modem.countCommands("AT+CCLK?"), clocks);
+  CHECK(!zoneOpen(1));
+}
+
+TEST(program_runs_from_local_clock) {
+  // The RTC was set to 05:30:00 when this many ms had passed
+  uint32_t at0530 = millis() - (SCHEDULE_RETRY_MS + CLOCK_RETRY_MS) - 15UL * 60000UL;
+  CHECK(hostRunUntil([] { return zoneOpen(1) && zoneOpen(3); }, 20UL * 60000UL));
+  uint32_t openedAfter = millis() - at0530;
+  REPORT("zones opened %.1f s after 06:00 on the modem RTC", (openedAfter - 30UL * 60000UL) / 1000.0);
+  CHECK(openedAfter >= 30UL * 60000UL);
+  CHECK(openedAfter < 30UL * 60000UL + 2000UL);
+
+  // Reported under the reserved local id with SLAVE1's start status
+  CHECK(hostRunUntil([] { return site.lastStatus(RUN_ID) >= 0; }, 60000UL));
+  CHECK_EQ(site.lastStatus(RUN_ID), (int)ThisRole::kStartStatus);
+  CHECK_EQ(site.lastStatus(12), -1);
+
+  CHECK(hostRunUntil([] { return !zoneOpen(1) && !zoneOpen(3); }, 3UL * 60000UL));
+  CHECK(hostRunUntil([] { return site.lastStatus(RUN_ID) == (int)ThisRole::kCompleteStatus; }, 60000UL));
+}
+
+TEST(dashboard_stop_reaches_a_local_run) {
+  // A second program a few minutes on, announced through the poll's V=.
+  // The dashboard then STOPs an irrigation of its own: the S=8 it gets
+  // from MASTER has to close the local run too.
+  site.scheduleBody = "V=4\nP=12;D=1;H=06:00;L=2;Z=1,3\nP=13;D=1;H=06:40;L=30;Z=1,3\n";
+  site.pollBody = "V=4";
+  const long run13 = LOCAL_RUN_ID_BASE + 13;
+  CHECK(hostRunUntil([] { return zoneOpen(1) && zoneOpen(3); }, 45UL * 60000UL));
+  CHECK(hostRunUntil([=] { return site.lastStatus(run13) == (int)ThisRole::kStartStatus; }, 60000UL));
+  hostRunFor(60000);
+  CHECK(zoneOpen(1));
+  site.pollBody = "ID=300;Z=1,3;T=30;M=20;S=8";
+  CHECK(hostRunUntil([] { return !zoneOpen(1) && !zoneOpen(3); }, POLL_INTERVAL_MS + 30000UL));
+  CHECK(hostRunUntil([] { return site.lastStatus(300) >= 0; }, 60000UL));
+  CHECK_EQ(site.lastStatus(run13), (int)ThisRole::kStopStatus);
+  CHECK_EQ(site.lastStatus(300), (int)ThisRole::kStopStatus);
+}
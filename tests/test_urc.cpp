@@ -0,0 +1,44 @@
+// Calls and SMS on a board built without push wake-up: no caller-id setup,
+// but unsolicited lines are still kept out of replies and calls hung up.
+
+#include "HostTest.h"
+#include "ClientRig.h"
+
+TEST(no_caller_id_setup_without_push_numbers) {
+  ClientRig rig;
+  rig.site.pollBody = "ID=202;Z=1,3;T=1;M=1;S=1";
+  rig.begin();
+  CHECK_EQ(rig.modem.countCommands("AT+CLIP"), 0U);
+  CHECK_EQ(rig.modem.countCommands("AT+CMGF"), 0U);
+  CHECK_EQ(rig.modem.countCommands("AT+CNMI"), 0U);
+  CHECK(rig.modem.countCommands("AT+SAPBR") > 0);
+}
+
+TEST(ring_inside_http_read_is_stripped) {
+  ClientRig rig;
+  rig.site.pollBody = "ID=203;Z=1,3;T=1;M=1;S=1";
+  rig.begin();
+  // The network still delivers RING to a modem without +CLIP; it lands
+  // between the +HTTPREAD header and the body it counts
+  rig.modem.injectAfter("AT+HTTPREAD", "RING\r\n", "+HTTPREAD: 24\r\n");
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 203L);
+  CHECK_EQ((int)cmd.numZones, 2);
+  CHECK_EQ((int)cmd.status, 1);
+  rig.settle();
+  CHECK_EQ(rig.modem.countCommands("ATH"), 1U);
+}
+
+TEST(ring_between_action_and_result_is_stripped) {
+  ClientRig rig;
+  rig.site.pollBody = "ID=204;Z=1,3;T=1;M=1;S=1";
+  rig.begin();
+  // Two rings while the GET is in flight: both go, one hang-up follows
+  rig.modem.injectAfter("AT+HTTPACTION", "\r\nRING\r\n\r\nRING\r\n", "\r\nOK\r\n");
+  IrrigationCommand cmd;
+  CHECK_EQ(rig.runUntilResult(cmd), 0);
+  CHECK_EQ(cmd.id, 204L);
+  rig.settle();
+  CHECK_EQ(rig.modem.countCommands("ATH"), 1U);
+}
@@ -0,0 +1,111 @@
+// Watchdog: a subsystem that stops checking in stops the feeding, the
+// reset cause survives the reboot, and a long network outage is not a
+// stall. Reboots are simulated by running the pre-main hook and begin()
+// again on a fresh instance.
+
+#include "HostTest.h"
+#include "Firmware.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+#include <avr/io.h>
+#include <avr/wdt.h>
+
+void captureResetFlags();
+extern "C" void WDT_vect(void);
+
+namespace {
+  void boot(Watchdog& w, uint8_t flags) {
+    MCUSR = flags;
+    captureResetFlags();
+    w.begin();
+  }
+
+  // One loop() pass in which the irrigation tick may hang
+  void pass(Watchdog& w, bool irrigationTicks) {
+    w.enter(SubModem);
+    w.enter(SubPoller);
+    w.checkIn(SubPoller);
+    w.enter(SubIrrigation);
+    if (irrigationTicks) w.checkIn(SubIrrigation);
+    w.enter(SubMain);
+    w.service();
+  }
+}
+
+TEST(stuck_irrigation_tick_stops_feeding) {
+  Watchdog w;
+  boot(w, _BV(PORF));
+  hostWdtResetStats();
+  uint32_t start = millis();
+  for (int i = 0; i < 60; i++) { pass(w, true); hostAdvance(1000); }
+  uint32_t stuck = millis();
+  for (int i = 0; i < 200; i++) { pass(w, false); hostAdvance(1000); }
+  CHECK(hostWdtLastFeedMs() - start >= 60000UL);
+  CHECK(hostWdtLastFeedMs() - stuck <= WATCHDOG_STALL_MS);
+  CHECK(hostWdtLastFeedMs() - stuck >= WATCHDOG_STALL_MS - 1000UL);
+
+  Watchdog after;
+  boot(after, _BV(WDRF));
+  uint8_t cause, subsystem;
+  CHECK(after.pendingReport(cause, subsystem));
+  CHECK_EQ((int)cause, (int)ResetStall);
+  CHECK_EQ((int)subsystem, (int)SubIrrigation);
+  after.reportSent();
+  CHECK(!after.pendingReport(cause, subsystem));
+}
+
+TEST(modem_and_schedule_are_breadcrumbs_only) {
+  // They never check in; only the poller and the irrigation tick count
+  Watchdog w;
+  boot(w, _BV(PORF));
+  hostWdtResetStats();
+  for (int i = 0; i < 600; i++) { pass(w, true); hostAdvance(1000); }
+  CHECK(hostWdtLongestGapMs() <= 1000UL);
+  CHECK(millis() - hostWdtLastFeedMs() <= 1000UL);
+}
+
+TEST(hang_is_noted_by_the_first_timeout) {
+  Watchdog w;
+  boot(w, _BV(PORF));
+  w.enter(SubPeerLink);
+  WDT_vect(); // loop() never came back to service()
+
+  Watchdog after;
+  boot(after, _BV(WDRF));
+  uint8_t cause, subsystem;
+  CHECK(after.pendingReport(cause, subsystem));
+  CHECK_EQ((int)cause, (int)ResetHang);
+  CHECK_EQ((int)subsystem, (int)SubPeerLink);
+}
+
+TEST(slow_pass_is_not_a_hang) {
+  Watchdog w;
+  boot(w, _BV(PORF));
+  w.enter(SubSchedule);
+  WDT_vect();
+  WDTCSR &= (uint8_t)~_BV(WDIE); // hardware clears it when the interrupt runs
+  w.service();
+  CHECK(WDTCSR & _BV(WDIE));
+
+  Watchdog after;
+  boot(after, _BV(EXTRF));
+  uint8_t cause, subsystem;
+  CHECK(after.pendingReport(cause, subsystem));
+  CHECK_EQ((int)cause, (int)ResetExternal);
+}
+
+TEST(two_hour_network_outage_is_not_a_stall) {
+  ModemEmulator modem;
+  SiteServer site;
+  modem.server = std::ref(site);
+  modem.bearerUp = false;
+  hostAttachModem(&modem);
+  setup();
+  hostWdtResetStats();
+  hostRunFor(2UL * 3600000UL);
+  CHECK(modem.countCommands("AT+CGATT=1") > 100); // kept retrying the attach
+  CHECK(hostWdtLongestGapMs() < 4000UL);
+  CHECK(millis() - hostWdtLastFeedMs() < 4000UL);
+  REPORT("attach attempts=%u longest feed gap=%ums",
+         (unsigned)modem.countCommands("AT+CGATT=1"), (unsigned)hostWdtLongestGapMs());
+}
@@ -0,0 +1,39 @@
+// Records a modem trace on the host: the sketch runs against the emulated
+// SIM900 through one irrigation (start on S=0, complete on S=4) and the
+// trace is dumped exactly as the 'd' console command prints it on a board.
+//
+//   trace_record [seconds] > session.trace
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Firmware.h"
+#include "ModemEmulator.h"
+#include "SiteServer.h"
+
+int main(int argc, char** argv) {
+  uint32_t seconds = argc > 1 ? (uint32_t)atol(argv[1]) : 240;
+
+  ModemEmulator modem;
+  SiteServer site;
+  uint32_t startedAt = 0;
+  site.onPoll = [&](const std::string&) {
+    int s = site.lastStatus(286) >= 1 ? 1 : 0;
+    if (s == 1 && startedAt == 0) startedAt = millis();
+    if (startedAt && millis() - startedAt > 70000UL) s = 4;
+    return "ID=286;Z=1,3;T=1;M=1;S=" + std::to_string(s);
+  };
+  modem.server = std::ref(site);
+  hostAttachModem(&modem);
+
+  setup();
+  hostRunFor(seconds * 1000UL);
+
+  Serial.hostOutput().clear();
+  Serial.hostInput("d");
+  loop();
+  fputs(Serial.hostOutput().c_str(), stdout);
+  fprintf(stderr, "recorded %us: %u commands, %u polls, %u status updates\n",
+          (unsigned)seconds, (unsigned)modem.commands.size(),
+          (unsigned)site.polls.size(), (unsigned)site.updates.size());
+  return 0;
+}
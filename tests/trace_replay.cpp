@@ -0,0 +1,168 @@
+// Replays a modem trace (the output of the 'd' console command, from a board
+// or from trace_record) against the sketch built for the host. The capture
+// stands in for the SIM900: its bytes reach the board at their recorded
+// times and everything the board writes is compared with the capture.
+//
+//   trace_replay session.trace
+//
+// Prints the commands the board sent, each irrigation record it parsed from
+// a poll, every output pin change and the host CPU time per loop() pass.
+// Exits 1 if the board wrote anything the capture does not contain or
+// stopped before consuming it.
+//
+// The replay starts the sketch from setup(), so the capture must start at
+// boot: a trace cleared with 'c' begins mid-session and will diverge. One
+// that filled the buffer (dropped > 0) replays up to where it stops.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Firmware.h"
+
+namespace {
+  // Trace records the board has not caught up with after this long mean
+  // it took a different path than the capture
+  const uint32_t STALL_MS = 120000UL;
+
+  bool parseDump(FILE* f, std::vector<uint8_t>& records, uint32_t& baseMs, unsigned& dropped) {
+    char line[512];
+    bool header = false;
+    while (fgets(line, sizeof(line), f)) {
+      unsigned long base = 0, count = 0, drop = 0;
+      if (sscanf(line, "# modem-trace v1 base=%lu records=%lu dropped=%lu", &base, &count, &drop) == 3) {
+        header = true;
+        baseMs = (uint32_t)base;
+        dropped = (unsigned)drop;
+        records.clear();
+        continue;
+      }
+      if (!header) continue; // console output before the dump
+      if (strncmp(line, "# end", 5) == 0) return true;
+      for (char* tok = strtok(line, " \r\n"); tok; tok = strtok(NULL, " \r\n")) {
+        unsigned long v = strtoul(tok, NULL, 16);
+        if (strlen(tok) != 4) return false;
+        records.push_back((uint8_t)(v >> 8));
+        records.push_back((uint8_t)v);
+      }
+    }
+    return false;
+  }
+
+  // Irrigation records the board parsed since the last call, from the
+  // "Got:" lines Sim900Client prints for each one
+  void printParsedCommands() {
+    std::string& out = Serial.hostOutput();
+    size_t start = 0;
+    size_t nl;
+    while ((nl = out.find('\n', start)) != std::string::npos) {
+      std::string line = out.substr(start, nl - start);
+      size_t got = line.find("] Got: ");
+      if (got != std::string::npos) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        printf("%10lu   parsed %s\n", (unsigned long)millis(), line.c_str() + got + 7);
+      }
+      start = nl + 1;
+    }
+    out.erase(0, start);
+  }
+
+  // Splits what the board writes into command lines for the log
+  class CommandTap : public Stream {
+  public:
+    explicit CommandTap(ModemTraceReplay& r) : replay(r) {}
+    int available() { return replay.available(); }
+    int read() { return replay.read(); }
+    int peek() { return replay.peek(); }
+    size_t write(uint8_t b) {
+      if (b == '\r' || b == '\n') {
+        if (!line.empty()) printf("%10lu > %s\n", (unsigned long)millis(), line.c_str());
+        line.clear();
+      } else {
+        line += (char)b;
+      }
+      return replay.write(b);
+    }
+    using Print::write;
+
+  private:
+    ModemTraceReplay& replay;
+    std::string line;
+  };
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace dump>\n", argv[0]);
+    return 2;
+  }
+  FILE* f = fopen(argv[1], "r");
+  if (!f) {
+    perror(argv[1]);
+    return 2;
+  }
+  std::vector<uint8_t> records;
+  uint32_t baseMs = 0;
+  unsigned dropped = 0;
+  bool ok = parseDump(f, records, baseMs, dropped);
+  fclose(f);
+  if (!ok || records.empty()) {
+    fprintf(stderr, "%s: no complete modem-trace v1 dump\n", argv[1]);
+    return 2;
+  }
+  if (dropped) fprintf(stderr, "note: the buffer filled up, %u records after it were not captured\n", dropped);
+
+  ModemTraceReplay replay(&records[0], records.size() / 2, baseMs);
+  CommandTap tap(replay);
+  hostAttachModem(&tap);
+  hostSetMillis(baseMs);
+  setup();
+  printParsedCommands();
+
+  uint8_t pins[HOST_PIN_COUNT];
+  for (uint8_t p = 0; p < HOST_PIN_COUNT; p++) pins[p] = hostPinLevel(p);
+
+  typedef std::chrono::steady_clock Clock;
+  uint64_t passes = 0;
+  uint64_t totalNs = 0;
+  uint64_t worstNs = 0;
+  bool stalled = false;
+  while (!replay.finished()) {
+    uint32_t before = millis();
+    Clock::time_point t0 = Clock::now();
+    loop();
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+    totalNs += ns;
+    if (ns > worstNs) worstNs = ns;
+    passes++;
+    if (millis() == before) hostAdvance(1);
+    printParsedCommands();
+
+    for (uint8_t p = 0; p < HOST_PIN_COUNT; p++) {
+      uint8_t level = hostPinLevel(p);
+      if (level == pins[p]) continue;
+      printf("%10lu   pin %u -> %s\n", (unsigned long)millis(), p, level ? "HIGH" : "LOW");
+      pins[p] = level;
+    }
+    if ((int32_t)(millis() - replay.nextEventMs()) > (int32_t)STALL_MS) {
+      stalled = true;
+      break;
+    }
+  }
+
+  printf("replayed %lu records, %lu ms simulated, %lu loop() passes\n",
+         (unsigned long)(records.size() / 2), (unsigned long)(millis() - baseMs),
+         (unsigned long)passes);
+  printf("host CPU per pass: avg %.2f us, max %.2f us\n",
+         passes ? totalNs / 1000.0 / passes : 0.0, worstNs / 1000.0);
+  // A capture that filled the buffer stops mid-session, usually in the
+  // middle of a command the board then finishes writing
+  uint32_t mismatches = replay.mismatches() + (dropped ? 0 : replay.writtenAfterEnd());
+  if (mismatches) printf("FAIL: %lu bytes written differ from the capture\n", (unsigned long)mismatches);
+  if (stalled) printf("FAIL: the board stopped following the capture at %lu ms\n",
+                      (unsigned long)replay.nextEventMs());
+  if (mismatches || stalled) return 1;
+  printf("OK: the board reproduced the capture\n");
+  return 0;
+}